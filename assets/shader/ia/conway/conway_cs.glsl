@@ -7,6 +7,9 @@ void main()
 {
   // Obtener el color previo
   ivec2 texelCoord = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(texelCoord, imageSize(prev_image))))
+    return;
+
   vec4 currentColor = imageLoad(prev_image, texelCoord);
 
   // Obtener el componente alpha del pixel actual
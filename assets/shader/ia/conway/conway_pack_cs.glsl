@@ -0,0 +1,25 @@
+layout (local_size_x = X_THREADS, local_size_y = Y_THREADS, local_size_z = Z_THREADS) in;
+
+layout (binding = PREV_IMG_BIND, rgba8) readonly uniform image2D prev_image;
+layout (binding = PACKED_CURR_BIND, std430) writeonly buffer CurrBlock { uint curr_[]; };
+
+uniform int u_words;
+uniform int u_width;
+uniform int u_height;
+
+void main() 
+{
+  ivec2 gid = ivec2(gl_GlobalInvocationID.xy);
+  if (gid.x >= u_words || gid.y >= u_height)
+    return;
+
+  uint word = 0u;
+  for (int i = 0; i < 32; i++)
+  {
+    int x = gid.x * 32 + i;
+    if (x < u_width && imageLoad(prev_image, ivec2(x, gid.y)).a > 0.5)
+      word |= 1u << i;
+  }
+
+  curr_[ARRAY_2D_INDEX(gid.x, gid.y, u_words)] = word;
+}
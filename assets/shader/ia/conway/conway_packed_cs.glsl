@@ -0,0 +1,54 @@
+layout (local_size_x = X_THREADS, local_size_y = Y_THREADS, local_size_z = Z_THREADS) in;
+
+// 32 cells per uint, bit i of the word x is the cell x * 32 + i
+layout (binding = PACKED_PREV_BIND, std430) readonly buffer PrevBlock { uint prev_[]; };
+layout (binding = PACKED_CURR_BIND, std430) writeonly buffer CurrBlock { uint curr_[]; };
+
+uniform int u_words;
+uniform int u_height;
+uniform uint u_last_mask;
+
+uint Word(int x, int y)
+{
+  // Dead outside the grid, same as imageLoad in conway_cs.glsl
+  if (x < 0 || x >= u_words || y < 0 || y >= u_height)
+    return 0u;
+
+  return prev_[ARRAY_2D_INDEX(x, y, u_words)];
+}
+
+void main() 
+{
+  ivec2 gid = ivec2(gl_GlobalInvocationID.xy);
+  if (gid.x >= u_words || gid.y >= u_height)
+    return;
+
+  uint up_w = Word(gid.x - 1, gid.y - 1), up_c = Word(gid.x, gid.y - 1), up_e = Word(gid.x + 1, gid.y - 1);
+  uint mid_w = Word(gid.x - 1, gid.y), mid_c = Word(gid.x, gid.y), mid_e = Word(gid.x + 1, gid.y);
+  uint dn_w = Word(gid.x - 1, gid.y + 1), dn_c = Word(gid.x, gid.y + 1), dn_e = Word(gid.x + 1, gid.y + 1);
+
+  // West and east neighbours of every bit
+  uint ul = (up_c << 1) | (up_w >> 31), ur = (up_c >> 1) | (up_e << 31);
+  uint ml = (mid_c << 1) | (mid_w >> 31), mr = (mid_c >> 1) | (mid_e << 31);
+  uint dl = (dn_c << 1) | (dn_w >> 31), dr = (dn_c >> 1) | (dn_e << 31);
+
+  // Full adders, total = a0 + 2 * (u1 + d1 + m1 + c0)
+  uint u0 = ul ^ up_c ^ ur;
+  uint u1 = (ul & up_c) | (ur & (ul ^ up_c));
+  uint d0 = dl ^ dn_c ^ dr;
+  uint d1 = (dl & dn_c) | (dr & (dl ^ dn_c));
+  uint m0 = ml ^ mr;
+  uint m1 = ml & mr;
+
+  uint a0 = u0 ^ d0 ^ m0;
+  uint c0 = (u0 & d0) | (m0 & (u0 ^ d0));
+
+  // Born with 3, survives with 2 or 3
+  uint one = (u1 ^ d1 ^ m1 ^ c0) & ~((u1 & d1) | (m1 & c0));
+  uint next = one & (a0 | mid_c);
+
+  if (gid.x == u_words - 1)
+    next &= u_last_mask;
+
+  curr_[ARRAY_2D_INDEX(gid.x, gid.y, u_words)] = next;
+}
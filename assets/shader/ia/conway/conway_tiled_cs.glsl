@@ -0,0 +1,79 @@
+layout (local_size_x = TILE_SIZE, local_size_y = TILE_SIZE, local_size_z = 1) in;
+
+layout (binding = CURR_IMG_BIND, rgba8) writeonly uniform image2D current_image;
+layout (binding = PREV_IMG_BIND, rgba8) readonly uniform image2D prev_image;
+
+// Generations advanced by this dispatch, the halo is u_steps cells wide
+uniform int u_steps;
+
+#define SHARED_SIZE (TILE_SIZE + 2 * MAX_TEMPORAL_STEPS)
+
+shared uint tile_[2][SHARED_SIZE * SHARED_SIZE];
+
+int TileIndex(ivec2 local)
+{
+  return local.y * SHARED_SIZE + local.x;
+}
+
+void main() 
+{
+  ivec2 grid_size = imageSize(prev_image);
+  int steps = clamp(u_steps, 1, MAX_TEMPORAL_STEPS);
+  int size = TILE_SIZE + 2 * steps;
+  ivec2 origin = ivec2(gl_WorkGroupID.xy) * TILE_SIZE - steps;
+  int local_index = int(gl_LocalInvocationIndex);
+
+  // Tile plus halo to shared memory, one imageLoad per cell
+  for (int i = local_index; i < size * size; i += TILE_SIZE * TILE_SIZE)
+  {
+    ivec2 local = ivec2(i % size, i / size);
+    ivec2 coord = origin + local;
+    uint alive = 0u;
+    if (all(greaterThanEqual(coord, ivec2(0))) && all(lessThan(coord, grid_size)))
+      alive = (imageLoad(prev_image, coord).a > 0.5) ? 1u : 0u;
+
+    tile_[0][TileIndex(local)] = alive;
+  }
+  barrier();
+
+  // Every generation the valid region loses one cell per side
+  for (int step = 0; step < steps; step++)
+  {
+    int src = step & 1;
+    int dst = src ^ 1;
+
+    int valid = size - 2 * (step + 1);
+    for (int i = local_index; i < valid * valid; i += TILE_SIZE * TILE_SIZE)
+    {
+      ivec2 local = ivec2(i % valid, i / valid) + step + 1;
+
+      // Dead outside the grid, same as imageLoad in conway_cs.glsl
+      ivec2 coord = origin + local;
+      uint alive = 0u;
+      if (all(greaterThanEqual(coord, ivec2(0))) && all(lessThan(coord, grid_size)))
+      {
+        uint neighbours = 0u;
+        for (int y = -1; y <= 1; y++)
+          for (int x = -1; x <= 1; x++)
+            neighbours += tile_[src][TileIndex(local + ivec2(x, y))];
+
+        uint cell = tile_[src][TileIndex(local)];
+        neighbours -= cell;
+
+        alive = (neighbours == 3u || (cell == 1u && neighbours == 2u)) ? 1u : 0u;
+      }
+
+      tile_[dst][TileIndex(local)] = alive;
+    }
+    barrier();
+  }
+
+  ivec2 texelCoord = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(texelCoord, grid_size)))
+    return;
+
+  ivec2 local = ivec2(gl_LocalInvocationID.xy) + steps;
+  float alpha = float(tile_[steps & 1][TileIndex(local)]);
+
+  imageStore(current_image, texelCoord, vec4(1.0, 1.0, 1.0, alpha));
+}
@@ -0,0 +1,20 @@
+layout (local_size_x = X_THREADS, local_size_y = Y_THREADS, local_size_z = Z_THREADS) in;
+
+layout (binding = CURR_IMG_BIND, rgba8) writeonly uniform image2D current_image;
+layout (binding = PACKED_CURR_BIND, std430) readonly buffer CurrBlock { uint curr_[]; };
+
+uniform int u_words;
+uniform int u_width;
+uniform int u_height;
+
+void main() 
+{
+  ivec2 texelCoord = ivec2(gl_GlobalInvocationID.xy);
+  if (texelCoord.x >= u_width || texelCoord.y >= u_height)
+    return;
+
+  uint word = curr_[ARRAY_2D_INDEX(texelCoord.x / 32, texelCoord.y, u_words)];
+  float alpha = float((word >> (texelCoord.x % 32)) & 1u);
+
+  imageStore(current_image, texelCoord, vec4(1.0, 1.0, 1.0, alpha));
+}
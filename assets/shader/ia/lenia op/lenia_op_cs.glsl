@@ -1,41 +1,41 @@
 layout (local_size_x = X_THREADS, local_size_y = Y_THREADS, local_size_z = 1) in;
 
-layout (binding = COUNTER_BIND, std430) buffer CounterBlock { Counter data_[]; };
+layout (binding = COUNTER_BIND, std430) readonly buffer PartialBlock { float partial_[]; };
 
 layout (binding = CURR_IMG_BIND, rgba8) writeonly uniform image2D current_image;
 layout (binding = PREV_IMG_BIND, rgba8) readonly uniform image2D prev_image;
 
 uniform int u_radius;
+uniform int u_band_start;
+uniform int u_band_rows;
 uniform float u_dt;
-uniform float u_mu;
-uniform float u_sigma;
-uniform float u_rho;
-uniform float u_omega;
 
-vec2 Convolution(ivec2 coords)
+#define UNIFORM_RADIUS u_radius
+
+// Adds the 2 * radius + 1 row partial sums, the weights already carry the
+// normalization so the result is the average
+float Convolution(ivec2 local, int width)
 {
   float sum = 0;
-  float total = 0;
-  int total_lines = TOTAL_LINES(u_radius);
-  for(int i = 0; i < total_lines; i++)
+  for(int local_y = -KERNEL_RADIUS; local_y <= KERNEL_RADIUS; local_y++)
   {
-    int index = ARRAY_3D_INDEX(coords.x, coords.y, i, C_HEIGHT, MAX_RADIUS);
-    sum += data_[index].live_;
-    total += data_[index].count_;
+    int row = local.y + KERNEL_RADIUS + local_y;
+    sum += partial_[(abs(local_y) * u_band_rows + row) * width + local.x];
   }
-  return vec2(sum, total);
+  return sum;
 }
 
 void main() 
 {
-  // Obtener el color previo
-  ivec2 texelCoord = ivec2(gl_GlobalInvocationID.xy);
-
-  vec2 conv = Convolution(texelCoord);
+  ivec2 size = imageSize(prev_image);
+  ivec2 local = ivec2(gl_GlobalInvocationID.xy);
+  ivec2 texelCoord = ivec2(local.x, u_band_start + local.y);
+  if (local.x >= size.x || local.y >= u_band_rows - 2 * KERNEL_RADIUS || texelCoord.y >= size.y)
+    return;
 
-  float avg = conv.x / conv.y;
+  float avg = Convolution(local, size.x);
 
-  float growth = (GaussBell(avg, u_mu, u_sigma) * 2.0) - 1.0;
+  float growth = GrowthLUT(avg);
 
   float value = imageLoad(prev_image, texelCoord).a;
 
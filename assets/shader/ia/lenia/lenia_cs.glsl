@@ -5,53 +5,50 @@ layout (binding = PREV_IMG_BIND, rgba8) readonly uniform image2D prev_image;
 
 uniform float u_radius;
 uniform float u_dt;
-uniform float u_mu;
-uniform float u_sigma;
-uniform float u_rho;
-uniform float u_omega;
 
-vec2 Convolution(ivec2 coords)
+#define UNIFORM_RADIUS int(u_radius)
+
+// Weights come normalized from lenia_tables.glsl
+float Convolution(ivec2 coords)
 {
+  ivec2 size = imageSize(prev_image);
   float sum = 0;
-  float total = 0;
-  for(int x = -int(u_radius); x <= int(u_radius); x++)
+  int radius = KERNEL_RADIUS;
+  for(int x = -radius; x <= radius; x++)
   {
-    for(int y = -int(u_radius); y <= int(u_radius); y++)
+    for(int y = -radius; y <= radius; y++)
     {
-      vec2 neighbord_texel = (coords + ivec2(x,y));
+      ivec2 neighbord_texel = (coords + ivec2(x,y));
       if (neighbord_texel.y < 0)
-        neighbord_texel.y = C_HEIGHT + neighbord_texel.y;
-      if (neighbord_texel.y >= C_HEIGHT)
-        neighbord_texel.y -= C_HEIGHT;
+        neighbord_texel.y = size.y + neighbord_texel.y;
+      if (neighbord_texel.y >= size.y)
+        neighbord_texel.y -= size.y;
 
       if (neighbord_texel.x < 0)
-        neighbord_texel.x = C_WIDTH + neighbord_texel.x;
-      if (neighbord_texel.x >= C_WIDTH)
-        neighbord_texel.x -= C_WIDTH;
+        neighbord_texel.x = size.x + neighbord_texel.x;
+      if (neighbord_texel.x >= size.x)
+        neighbord_texel.x -= size.x;
 
-      float alpha =  imageLoad(prev_image, ivec2(neighbord_texel)).a;
+      float alpha =  imageLoad(prev_image, neighbord_texel).a;
 
-      float norm_rad = EuclidianDistance(x, y) / u_radius;
-      float weight = GaussBell(norm_rad, u_rho, u_omega);
-      
-      sum += (alpha * weight);
-      total += weight;
+      sum += (alpha * Weight(x, y, radius));
     }
   }
-  return vec2(sum, total);
+  return sum;
 }
 
 void main() 
 {
   // Obtener el color previo
   ivec2 texelCoord = ivec2(gl_GlobalInvocationID.xy);
-  vec4 currentColor = imageLoad(prev_image, texelCoord);
+  if (any(greaterThanEqual(texelCoord, imageSize(prev_image))))
+    return;
 
-  vec2 conv = Convolution(texelCoord);
+  vec4 currentColor = imageLoad(prev_image, texelCoord);
 
-  float avg = conv.x / conv.y;
+  float avg = Convolution(texelCoord);
 
-  float growth = (GaussBell(avg, u_mu, u_sigma) * 2.0) - 1.0;
+  float growth = GrowthLUT(avg);
 
   float value = imageLoad(prev_image, texelCoord).a;
 
@@ -0,0 +1,30 @@
+layout (local_size_x = FFT_THREADS, local_size_y = 1, local_size_z = 1) in;
+
+// Kernel spectrum, same layout as the spectrum and scaled by 1 / (w * h)
+layout (std430, binding = KERNEL_BIND) readonly buffer Kernel
+{
+  vec2 kernel_[];
+};
+
+// Forward column FFT, product with the kernel and inverse, one column per
+// workgroup without leaving shared memory
+void main()
+{
+  int local_index = int(gl_LocalInvocationIndex);
+  int k = int(gl_WorkGroupID.x);
+
+  for (int y = local_index; y < u_height; y += FFT_THREADS)
+    fft_data_[0][y] = spectrum_[y * u_half + k];
+  barrier();
+
+  int src = FFT(u_height, 0, -1.0);
+
+  for (int y = local_index; y < u_height; y += FFT_THREADS)
+    fft_data_[src][y] = ComplexMul(fft_data_[src][y], kernel_[y * u_half + k]);
+  barrier();
+
+  src = FFT(u_height, src, 1.0);
+
+  for (int y = local_index; y < u_height; y += FFT_THREADS)
+    spectrum_[y * u_half + k] = fft_data_[src][y];
+}
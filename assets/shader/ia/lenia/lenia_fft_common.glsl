@@ -0,0 +1,47 @@
+// Shared by the Lenia FFT passes, one workgroup transforms one row or column
+// of a power of two length held in shared memory
+
+#define PI 3.14159265358979
+
+layout (std430, binding = SPECTRUM_BIND) buffer Spectrum
+{
+  vec2 spectrum_[];
+};
+
+uniform int u_width;
+uniform int u_height;
+uniform int u_half; // Columns kept of every row spectrum, width / 2 + 1
+
+shared vec2 fft_data_[2][MAX_FFT_SIZE];
+
+vec2 ComplexMul(vec2 a, vec2 b)
+{
+  return vec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+// Radix 2 Stockham over fft_data_[src], direction -1 forward and 1 inverse
+// (not scaled). Returns the buffer that holds the result in natural order.
+int FFT(int n, int src, float direction)
+{
+  int local_index = int(gl_LocalInvocationIndex);
+
+  for (int span = 1; span < n; span *= 2)
+  {
+    for (int j = local_index; j < n / 2; j += FFT_THREADS)
+    {
+      int k = j & (span - 1);
+      float angle = direction * PI * float(k) / float(span);
+      vec2 a = fft_data_[src][j];
+      vec2 b = ComplexMul(fft_data_[src][j + n / 2], vec2(cos(angle), sin(angle)));
+
+      int dst = (j - k) * 2 + k;
+      fft_data_[src ^ 1][dst] = a + b;
+      fft_data_[src ^ 1][dst + span] = a - b;
+    }
+
+    src ^= 1;
+    barrier();
+  }
+
+  return src;
+}
@@ -0,0 +1,53 @@
+layout (local_size_x = FFT_THREADS, local_size_y = 1, local_size_z = 1) in;
+
+layout (binding = CURR_IMG_BIND, rgba8) writeonly uniform image2D current_image;
+layout (binding = PREV_IMG_BIND, rgba8) readonly uniform image2D prev_image;
+
+uniform float u_dt;
+uniform float u_mu;
+uniform float u_sigma;
+
+// Inverse of the rows pass, the potentials of both rows come back as the
+// real and imaginary parts, then the growth of lenia_cs.glsl
+void main()
+{
+  int local_index = int(gl_LocalInvocationIndex);
+  int y0 = int(gl_WorkGroupID.x) * 2;
+  int y1 = y0 + 1;
+
+  for (int k = local_index; k < u_width; k += FFT_THREADS)
+  {
+    int index = (k < u_half) ? k : u_width - k;
+    vec2 a = spectrum_[y0 * u_half + index];
+    vec2 b = (y1 < u_height) ? spectrum_[y1 * u_half + index] : vec2(0.0);
+
+    // Upper half from the conjugates
+    if (k >= u_half)
+    {
+      a.y = -a.y;
+      b.y = -b.y;
+    }
+
+    fft_data_[0][k] = a + vec2(-b.y, b.x);
+  }
+  barrier();
+
+  int src = FFT(u_width, 0, 1.0);
+
+  for (int x = local_index; x < u_width; x += FFT_THREADS)
+  {
+    for (int y = y0; y <= y1 && y < u_height; y++)
+    {
+      ivec2 texelCoord = ivec2(x, y);
+      float avg = (y == y0) ? fft_data_[src][x].x : fft_data_[src][x].y;
+
+      float growth = (GaussBell(avg, u_mu, u_sigma) * 2.0) - 1.0;
+
+      float value = imageLoad(prev_image, texelCoord).a;
+
+      float c = clamp(value + (1.0 / u_dt) * growth, 0.0, 1.0);
+
+      imageStore(current_image, texelCoord, vec4(1.0, 1.0, 1.0, c));
+    }
+  }
+}
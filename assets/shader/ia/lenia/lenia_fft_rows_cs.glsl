@@ -0,0 +1,34 @@
+layout (local_size_x = FFT_THREADS, local_size_y = 1, local_size_z = 1) in;
+
+layout (binding = PREV_IMG_BIND, rgba8) readonly uniform image2D prev_image;
+
+// Two real rows per workgroup as z = a + i * b, split back with the
+// hermitian symmetry and stored as half spectra:
+//   A[k] = (Z[k] + conj(Z[n - k])) / 2
+//   B[k] = (Z[k] - conj(Z[n - k])) / 2i
+void main()
+{
+  int local_index = int(gl_LocalInvocationIndex);
+  int y0 = int(gl_WorkGroupID.x) * 2;
+  int y1 = y0 + 1;
+
+  for (int x = local_index; x < u_width; x += FFT_THREADS)
+  {
+    float a = imageLoad(prev_image, ivec2(x, y0)).a;
+    float b = (y1 < u_height) ? imageLoad(prev_image, ivec2(x, y1)).a : 0.0;
+    fft_data_[0][x] = vec2(a, b);
+  }
+  barrier();
+
+  int src = FFT(u_width, 0, -1.0);
+
+  for (int k = local_index; k < u_half; k += FFT_THREADS)
+  {
+    vec2 z = fft_data_[src][k];
+    vec2 mirror = fft_data_[src][(u_width - k) % u_width] * vec2(1.0, -1.0);
+
+    spectrum_[y0 * u_half + k] = (z + mirror) * 0.5;
+    if (y1 < u_height)
+      spectrum_[y1 * u_half + k] = ComplexMul(z - mirror, vec2(0.0, -0.5));
+  }
+}
@@ -0,0 +1,40 @@
+// Lenia tables built by LeniaTables on the CPU whenever a slider changes.
+// Specialized variants define RADIUS and the WEIGHTS constant array before
+// this file, so the unrolled loops fold the weights in.
+
+// KERNEL_RADIUS is a constant in the variants, the shaders define
+// UNIFORM_RADIUS for the generic one
+#ifdef RADIUS
+#define KERNEL_RADIUS RADIUS
+#else
+#define KERNEL_RADIUS UNIFORM_RADIUS
+
+// (2 * radius + 1)^2 weights already divided by their total
+layout (std430, binding = WEIGHTS_BIND) readonly buffer Weights
+{
+  float weights_[];
+};
+#endif
+
+// 2 * GaussBell(avg, mu, sigma) - 1 sampled on [0, 1]
+layout (std430, binding = GROWTH_BIND) readonly buffer Growth
+{
+  float growth_[];
+};
+
+float Weight(int x, int y, int radius)
+{
+#ifdef RADIUS
+  return WEIGHTS[(y + RADIUS) * TOTAL_COLUMNS(RADIUS) + (x + RADIUS)];
+#else
+  int side = TOTAL_COLUMNS(radius);
+  return weights_[(y + radius) * side + (x + radius)];
+#endif
+}
+
+float GrowthLUT(float avg)
+{
+  float position = clamp(avg, 0.0, 1.0) * float(GROWTH_LUT_SIZE - 1);
+  int index = min(int(position), GROWTH_LUT_SIZE - 2);
+  return mix(growth_[index], growth_[index + 1], position - float(index));
+}
@@ -0,0 +1,37 @@
+layout (local_size_x = X_THREADS, local_size_y = Y_THREADS, local_size_z = 1) in;
+
+// Both ping-pong images get the same state
+layout (binding = CURR_IMG_BIND, rgba8) writeonly uniform image2D current_image;
+layout (binding = PREV_IMG_BIND, rgba8) writeonly uniform image2D prev_image;
+
+uniform uint u_seed;
+uniform int u_mode; // SEED_CLEAR, SEED_BINARY or SEED_CONTINUOUS
+
+// PCG hash, one counter per cell so the state only depends on the seed and
+// the cell index, not on the dispatch order
+uint PCG(uint v)
+{
+  uint state = v * 747796405u + 2891336453u;
+  uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+  return (word >> 22u) ^ word;
+}
+
+void main()
+{
+  ivec2 texelCoord = ivec2(gl_GlobalInvocationID.xy);
+  ivec2 size = imageSize(current_image);
+  if (any(greaterThanEqual(texelCoord, size)))
+    return;
+
+  uint index = uint(texelCoord.y) * uint(size.x) + uint(texelCoord.x);
+  uint random = PCG(index ^ PCG(u_seed));
+
+  vec4 color = vec4(0.0);
+  if (u_mode == SEED_BINARY)
+    color = vec4(1.0, 1.0, 1.0, (random % 5u < 2u) ? 1.0 : 0.0); // 40% alive
+  if (u_mode == SEED_CONTINUOUS)
+    color = vec4(1.0, 1.0, 1.0, float(random % 255u) / 255.0);
+
+  imageStore(current_image, texelCoord, color);
+  imageStore(prev_image, texelCoord, color);
+}
@@ -0,0 +1,107 @@
+layout (local_size_x = SCAN_THREADS, local_size_y = 1, local_size_z = 1) in;
+
+// Summed-area table of the live cells, sat_[x + y * width] holds the cells
+// alive in [0, x] x [0, y]. Built with two dispatches of this shader, first
+// one workgroup per row scanning prev_image, then one per column scanning
+// the row sums in place.
+layout (binding = COUNTER_BIND, std430) buffer SatBlock { uint sat_[]; };
+
+layout (binding = PREV_IMG_BIND, rgba8) readonly uniform image2D prev_image;
+
+uniform int u_vertical;
+
+shared uint scan_[SCAN_THREADS * 2];
+
+// Blelloch exclusive scan of scan_, returns the sum of all the values
+uint ScanShared()
+{
+  int thread = int(gl_LocalInvocationIndex);
+  int offset = 1;
+
+  // Up-sweep
+  for (int d = SCAN_THREADS; d > 0; d >>= 1)
+  {
+    barrier();
+    if (thread < d)
+    {
+      int ai = offset * (2 * thread + 1) - 1;
+      int bi = offset * (2 * thread + 2) - 1;
+      scan_[bi] += scan_[ai];
+    }
+    offset *= 2;
+  }
+
+  barrier();
+  uint total = scan_[SCAN_THREADS * 2 - 1];
+  barrier();
+
+  if (thread == 0)
+    scan_[SCAN_THREADS * 2 - 1] = 0u;
+
+  // Down-sweep
+  for (int d = 1; d <= SCAN_THREADS; d *= 2)
+  {
+    offset >>= 1;
+    barrier();
+    if (thread < d)
+    {
+      int ai = offset * (2 * thread + 1) - 1;
+      int bi = offset * (2 * thread + 2) - 1;
+      uint value = scan_[ai];
+      scan_[ai] = scan_[bi];
+      scan_[bi] += value;
+    }
+  }
+  barrier();
+
+  return total;
+}
+
+void main() 
+{
+  ivec2 size = imageSize(prev_image);
+  int line = int(gl_WorkGroupID.x);
+  int line_length = (u_vertical != 0) ? size.y : size.x;
+  int thread = int(gl_LocalInvocationIndex);
+
+  // The line goes in blocks of SCAN_THREADS * 2 carrying the running sum
+  uint carry = 0u;
+  for (int block = 0; block < line_length; block += SCAN_THREADS * 2)
+  {
+    uint values[2];
+    for (int i = 0; i < 2; i++)
+    {
+      int position = block + thread * 2 + i;
+      values[i] = 0u;
+
+      if (position < line_length)
+      {
+        if (u_vertical != 0)
+          values[i] = sat_[position * size.x + line];
+        else
+          values[i] = (imageLoad(prev_image, ivec2(position, line)).a > 0.5) ? 1u : 0u;
+      }
+
+      scan_[thread * 2 + i] = values[i];
+    }
+
+    uint total = ScanShared();
+
+    for (int i = 0; i < 2; i++)
+    {
+      int position = block + thread * 2 + i;
+      uint inclusive = carry + scan_[thread * 2 + i] + values[i];
+
+      if (position < line_length)
+      {
+        if (u_vertical != 0)
+          sat_[position * size.x + line] = inclusive;
+        else
+          sat_[line * size.x + position] = inclusive;
+      }
+    }
+
+    carry += total;
+    barrier();
+  }
+}
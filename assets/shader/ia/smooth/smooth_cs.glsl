@@ -1,30 +1,61 @@
 layout (local_size_x = X_THREADS, local_size_y = Y_THREADS, local_size_z = Z_THREADS) in;
 
-layout (binding = COUNTER_BIND, std430) buffer CounterBlock { Counter data_[]; };
-layout (binding = INDICES_BIND, std430) buffer IndicesBlock { vec2 indices_[]; };
+layout (binding = COUNTER_BIND, std430) readonly buffer SatBlock { uint sat_[]; };
+
+// Offsets shared by every pixel, rows [x, y] and columns (z, w]. The first
+// one are the near neighbours, the rest the outer disk.
+layout (binding = INDICES_BIND, std430) readonly buffer SpansBlock { ivec4 spans_[]; };
 
 layout (binding = CURR_IMG_BIND, rgba8) writeonly uniform image2D current_image;
 layout (binding = PREV_IMG_BIND, rgba8) readonly uniform image2D prev_image;
 
+uniform int u_spans;
+uniform int u_reach; // No span goes further than this from the cell
+
+uint Sat(int x, int y, int width)
+{
+  return (y < 0) ? 0u : sat_[x + y * width];
+}
+
 vec2 SumNeighbors(int col, int row, int for_start, int for_end)
 {
+  ivec2 size = imageSize(prev_image);
+  bool inside = col - u_reach >= 0 && col + u_reach < size.x && row - u_reach >= 0 && row + u_reach < size.y;
+
   float sum_life = 0.0;
   float total_count = 0.0;
 
-  for(int z = for_start; z < for_end; z += 2)
+  for(int i = for_start; i < for_end; i++)
   {
-    int index = ARRAY_3D_INDEX(col, row, z, C_HEIGHT, C_DEPTH);
-
-    ivec2 start_coord = ivec2(indices_[index]);
-    ivec2 end_coord = ivec2(indices_[index + 1]);
-
-    Counter start_counter = data_[start_coord.x + start_coord.y * C_WIDTH];
-    Counter end_counter = data_[end_coord.x + end_coord.y * C_WIDTH];
-
-    Counter counter = Counter(end_counter.live_ - start_counter.live_, end_counter.count_ - start_counter.count_);
-    
-    sum_life += counter.live_;
-    total_count += counter.count_;
+    ivec4 span = spans_[i];
+
+    // One rectangle, four reads
+    if (inside)
+    {
+      int top = row + span.x - 1;
+      int bottom = row + span.y;
+      int left = col + span.z;
+      int right = col + span.w;
+
+      uint live = Sat(right, bottom, size.x) - Sat(left, bottom, size.x) - Sat(right, top, size.x) + Sat(left, top, size.x);
+
+      sum_life += float(live);
+      total_count += float((span.y - span.x + 1) * (span.w - span.z));
+      continue;
+    }
+
+    // Row by row clamping the ends to the grid
+    for (int y = span.x; y <= span.y; y++)
+    {
+      ivec2 start_coord = clamp(ivec2(col + span.z, row + y), ivec2(0), size - 1);
+      ivec2 end_coord = clamp(ivec2(col + span.w, row + y), ivec2(0), size - 1);
+
+      uint end_live = Sat(end_coord.x, end_coord.y, size.x) - Sat(end_coord.x, end_coord.y - 1, size.x);
+      uint start_live = Sat(start_coord.x, start_coord.y, size.x) - Sat(start_coord.x, start_coord.y - 1, size.x);
+
+      sum_life += float(end_live) - float(start_live);
+      total_count += float(end_coord.x - start_coord.x);
+    }
   }
 
   return vec2(sum_life, total_count);
@@ -32,8 +63,8 @@ vec2 SumNeighbors(int col, int row, int for_start, int for_end)
 
 float getAlpha(int col, int row)
 {
-  vec2 far = SumNeighbors(col, row, NEAR_NEIGHBORS, C_DEPTH);
-  vec2 near = SumNeighbors(col, row, 0, NEAR_NEIGHBORS);
+  vec2 far = SumNeighbors(col, row, 1, u_spans);
+  vec2 near = SumNeighbors(col, row, 0, 1);
 
   far -= near;
 
@@ -54,9 +85,12 @@ float getAlpha(int col, int row)
 void main() 
 {
   ivec2 texelCoord = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(texelCoord, imageSize(prev_image))))
+    return;
+
   vec4 currentColor = imageLoad(prev_image, texelCoord);
 
   vec4 updatedColor = vec4(currentColor.rgb, getAlpha(texelCoord.x, texelCoord.y));
 
   imageStore(current_image, texelCoord, updatedColor);
-}
\ No newline at end of file
+}
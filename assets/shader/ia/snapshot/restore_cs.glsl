@@ -0,0 +1,33 @@
+layout (local_size_x = X_THREADS, local_size_y = Y_THREADS, local_size_z = 1) in;
+
+// Both ping-pong images get the restored state
+layout (binding = CURR_IMG_BIND, rgba8) writeonly uniform image2D current_image;
+layout (binding = PREV_IMG_BIND, rgba8) writeonly uniform image2D prev_image;
+
+// Snapshot cells in row order, little endian words
+layout (std430, binding = SNAPSHOT_BIND) readonly buffer SnapshotBuffer
+{
+  uint cells[];
+};
+
+uniform int u_encoding; // SNAPSHOT_BITS or SNAPSHOT_BYTES
+
+void main()
+{
+  ivec2 texelCoord = ivec2(gl_GlobalInvocationID.xy);
+  ivec2 size = imageSize(current_image);
+  if (any(greaterThanEqual(texelCoord, size)))
+    return;
+
+  uint index = uint(texelCoord.y) * uint(size.x) + uint(texelCoord.x);
+
+  float alpha;
+  if (u_encoding == SNAPSHOT_BITS)
+    alpha = float((cells[index >> 5u] >> (index & 31u)) & 1u);
+  else
+    alpha = float((cells[index >> 2u] >> ((index & 3u) * 8u)) & 255u) / 255.0;
+
+  vec4 color = vec4(1.0, 1.0, 1.0, alpha);
+  imageStore(current_image, texelCoord, color);
+  imageStore(prev_image, texelCoord, color);
+}
@@ -0,0 +1,39 @@
+layout (local_size_x = SNAPSHOT_THREADS, local_size_y = 1, local_size_z = 1) in;
+
+layout (binding = PREV_IMG_BIND, rgba8) readonly uniform image2D state_image;
+
+// Snapshot cells in row order, the layout restore_cs.glsl reads
+layout (std430, binding = SNAPSHOT_BIND) writeonly buffer SnapshotBuffer
+{
+  uint cells[];
+};
+
+uniform int u_encoding; // SNAPSHOT_BITS or SNAPSHOT_BYTES
+
+void main()
+{
+  // Rows of groups past the dispatch limit of a single dimension
+  uint word = gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x + gl_GlobalInvocationID.x;
+
+  ivec2 size = imageSize(state_image);
+  uint count = uint(size.x) * uint(size.y);
+  uint per_word = (u_encoding == SNAPSHOT_BITS) ? 32u : 4u;
+  uint first = word * per_word;
+  if (first >= count)
+    return;
+
+  uint value = 0u;
+  for (uint i = 0u; i < per_word && first + i < count; i++)
+  {
+    uint index = first + i;
+    ivec2 coord = ivec2(int(index % uint(size.x)), int(index / uint(size.x)));
+    uint alpha = uint(imageLoad(state_image, coord).a * 255.0 + 0.5);
+
+    if (u_encoding == SNAPSHOT_BITS)
+      value |= ((alpha > 127u) ? 1u : 0u) << i;
+    else
+      value |= alpha << (i * 8u);
+  }
+
+  cells[word] = value;
+}
@@ -0,0 +1,88 @@
+layout (local_size_x = X_THREADS, local_size_y = Y_THREADS, local_size_z = 1) in;
+
+layout (binding = PREV_IMG_BIND, rgba8) readonly uniform image2D state_image;
+
+// Cleared before the pass, each workgroup adds its totals once
+layout (std430, binding = STATS_BIND) buffer StatsBuffer
+{
+  uint stats[STATS_VALUES];
+};
+
+#define THREADS (X_THREADS * Y_THREADS)
+
+shared uvec4 partial_[THREADS];
+shared uint histogram_[STATS_BINS];
+
+// Carries into the high word, the additions commute so the order of the
+// workgroups does not matter
+void Add64(uint index, uint value)
+{
+  uint old = atomicAdd(stats[index], value);
+  if (old + value < old)
+    atomicAdd(stats[index + 1u], 1u);
+}
+
+void main()
+{
+  uint local_index = gl_LocalInvocationIndex;
+  if (local_index < STATS_BINS)
+    histogram_[local_index] = 0u;
+  barrier();
+
+  // Population, mass, x and y moments of STATS_ROWS cells. A workgroup
+  // covers 256 cells at most, its sums fit in 32 bits
+  ivec2 size = imageSize(state_image);
+  int x = int(gl_GlobalInvocationID.x);
+  int y0 = int(gl_WorkGroupID.y) * Y_THREADS * STATS_ROWS + int(gl_LocalInvocationID.y);
+  uvec4 sums = uvec4(0u);
+
+  for (int row = 0; row < STATS_ROWS; row++)
+  {
+    int y = y0 + row * Y_THREADS;
+    if (x >= size.x || y >= size.y)
+      continue;
+
+    uint value = uint(imageLoad(state_image, ivec2(x, y)).a * 255.0 + 0.5);
+    sums += uvec4((value > 0u) ? 1u : 0u, value, uint(x) * value, uint(y) * value);
+    atomicAdd(histogram_[value * STATS_BINS / 256u], 1u);
+  }
+
+  // Every invocation takes part in the reduction, the ones outside the grid
+  // add zeros
+#ifdef GL_KHR_shader_subgroup_arithmetic
+  sums = subgroupAdd(sums);
+  if (subgroupElect())
+    partial_[gl_SubgroupID] = sums;
+  barrier();
+
+  if (local_index == 0u)
+  {
+    sums = partial_[0];
+    for (uint i = 1u; i < gl_NumSubgroups; i++)
+      sums += partial_[i];
+  }
+#else
+  partial_[local_index] = sums;
+  barrier();
+
+  for (uint stride = THREADS / 2u; stride > 0u; stride >>= 1u)
+  {
+    if (local_index < stride)
+      partial_[local_index] += partial_[local_index + stride];
+    barrier();
+  }
+
+  sums = partial_[0];
+#endif
+
+  if (local_index == 0u)
+  {
+    atomicAdd(stats[STATS_POPULATION], sums.x);
+    Add64(STATS_MASS, sums.y);
+    Add64(STATS_MOMENT_X, sums.z);
+    Add64(STATS_MOMENT_Y, sums.w);
+  }
+
+  if (local_index < STATS_BINS && histogram_[local_index] > 0u)
+    atomicAdd(stats[STATS_HISTOGRAM + local_index], histogram_[local_index]);
+}
@@ -0,0 +1,84 @@
+#include "ia/conway_cpu.h"
+#include "ia/defines.h"
+
+// Checks ConwayCPU against a per cell version of conway_cs.glsl
+// (dead outside the grid), including widths that are not multiple of 64
+
+struct Pixel
+{
+  u_byte r, g, b, a;
+};
+
+void RandomImage(std::vector<Pixel> &image)
+{
+  for (Pixel &pixel : image)
+    pixel = Pixel{255, 255, 255, static_cast<u_byte>((rand() % 5 < 2) ? 255 : 0)};
+}
+
+void OriginalConway(std::vector<Pixel> &prev_image, std::vector<Pixel> &image, s32 width, s32 height)
+{
+  for (s32 y = 0; y < height; y++)
+  {
+    for (s32 x = 0; x < width; x++)
+    {
+      s32 alive_neighbours = 0;
+      for (s32 i = -1; i <= 1; i++)
+      {
+        for (s32 j = -1; j <= 1; j++)
+        {
+          s32 nx = x + i;
+          s32 ny = y + j;
+          if ((i != 0 || j != 0) && nx >= 0 && nx < width && ny >= 0 && ny < height)
+            alive_neighbours += prev_image[ARRAY_2D_INDEX(nx, ny, width)].a ? 1 : 0;
+        }
+      }
+
+      boolean alive = prev_image[ARRAY_2D_INDEX(x, y, width)].a != 0;
+      alive = alive ? (alive_neighbours == 2 || alive_neighbours == 3) : (alive_neighbours == 3);
+      image[ARRAY_2D_INDEX(x, y, width)] = Pixel{255, 255, 255, static_cast<u_byte>(alive ? 255 : 0)};
+    }
+  }
+}
+
+void Check(s32 width, s32 height, s32 generations)
+{
+  std::vector<Pixel> original(static_cast<size_t>(width * height));
+  std::vector<Pixel> next(original.size());
+  std::vector<Pixel> packed(original.size());
+  RandomImage(original);
+
+  ConwayCPU conway;
+  conway.init(static_cast<u32>(width), static_cast<u32>(height));
+  conway.load(reinterpret_cast<u_byte *>(original.data()));
+
+  for (s32 generation = 0; generation < generations; generation++)
+  {
+    OriginalConway(original, next, width, height);
+    std::swap(original, next);
+
+    conway.step();
+    conway.store(reinterpret_cast<u_byte *>(packed.data()));
+
+    for (size_t i = 0; i < original.size(); i++)
+    {
+      boolean check = (original[i].a == packed[i].a);
+      if (!check)
+        fprintf(stderr, "Failed %dx%d generation %d in %zu\n", width, height, generation, i);
+      assert(check);
+    }
+  }
+}
+
+int main(int, char **)
+{
+  srand(static_cast<u32>(time(NULL)));
+
+  Check(1024, 64, 20);
+  Check(100, 37, 50);
+  Check(257, 129, 50);
+  Check(63, 1, 5);
+  Check(1, 1, 5);
+
+  fprintf(stdout, "All correct\n");
+  return 0;
+}
@@ -0,0 +1,129 @@
+#include "ia/hashlife.h"
+#include "ia/defines.h"
+
+// Checks Hashlife against a per cell Conway on a grid padded further than
+// the cells can travel, so its dead border never reaches the window
+// Hashlife stores. Covers several 2^k steps and forced collections.
+
+struct Pixel
+{
+  u_byte r, g, b, a;
+};
+
+void RandomImage(std::vector<Pixel> &image)
+{
+  for (Pixel &pixel : image)
+    pixel = Pixel{255, 255, 255, static_cast<u_byte>((rand() % 5 < 2) ? 255 : 0)};
+}
+
+void OriginalConway(std::vector<Pixel> &prev_image, std::vector<Pixel> &image, s32 width, s32 height)
+{
+  for (s32 y = 0; y < height; y++)
+  {
+    for (s32 x = 0; x < width; x++)
+    {
+      s32 alive_neighbours = 0;
+      for (s32 i = -1; i <= 1; i++)
+      {
+        for (s32 j = -1; j <= 1; j++)
+        {
+          s32 nx = x + i;
+          s32 ny = y + j;
+          if ((i != 0 || j != 0) && nx >= 0 && nx < width && ny >= 0 && ny < height)
+            alive_neighbours += prev_image[ARRAY_2D_INDEX(nx, ny, width)].a ? 1 : 0;
+        }
+      }
+
+      boolean alive = prev_image[ARRAY_2D_INDEX(x, y, width)].a != 0;
+      alive = alive ? (alive_neighbours == 2 || alive_neighbours == 3) : (alive_neighbours == 3);
+      image[ARRAY_2D_INDEX(x, y, width)] = Pixel{255, 255, 255, static_cast<u_byte>(alive ? 255 : 0)};
+    }
+  }
+}
+
+// max_bytes 0 keeps the default limit, 1 collects after every step
+void Check(s32 width, s32 height, u32 step_log2, s32 steps, size_t max_bytes)
+{
+  s32 generations = steps << step_log2;
+  s32 padding = generations + 1;
+  s32 padded_width = width + padding * 2;
+  s32 padded_height = height + padding * 2;
+
+  std::vector<Pixel> window(static_cast<size_t>(width * height));
+  RandomImage(window);
+
+  std::vector<Pixel> original(static_cast<size_t>(padded_width * padded_height), Pixel{255, 255, 255, 0});
+  std::vector<Pixel> next(original.size());
+  for (s32 y = 0; y < height; y++)
+    for (s32 x = 0; x < width; x++)
+      original[ARRAY_2D_INDEX(x + padding, y + padding, padded_width)] = window[ARRAY_2D_INDEX(x, y, width)];
+
+  Hashlife hashlife;
+  hashlife.setStepLog2(step_log2);
+  if (max_bytes)
+    hashlife.setMaxBytes(max_bytes);
+  hashlife.load(reinterpret_cast<u_byte *>(window.data()), static_cast<u32>(width), static_cast<u32>(height));
+
+  for (s32 step = 0; step < steps; step++)
+  {
+    for (s32 generation = 0; generation < (1 << step_log2); generation++)
+    {
+      OriginalConway(original, next, padded_width, padded_height);
+      std::swap(original, next);
+    }
+
+    hashlife.step();
+    hashlife.store(reinterpret_cast<u_byte *>(window.data()), static_cast<u32>(width), static_cast<u32>(height));
+
+    u64 population = 0;
+    for (const Pixel &pixel : original)
+      population += pixel.a ? 1 : 0;
+
+    boolean check = (population == hashlife.population());
+    if (!check)
+      fprintf(stderr, "Failed %dx%d 2^%u step %d population %llu != %llu\n", width, height, step_log2, step,
+              static_cast<unsigned long long>(hashlife.population()), static_cast<unsigned long long>(population));
+    assert(check);
+
+    for (s32 y = 0; y < height; y++)
+    {
+      for (s32 x = 0; x < width; x++)
+      {
+        check = (original[ARRAY_2D_INDEX(x + padding, y + padding, padded_width)].a == window[ARRAY_2D_INDEX(x, y, width)].a);
+        if (!check)
+          fprintf(stderr, "Failed %dx%d 2^%u step %d in %d, %d\n", width, height, step_log2, step, x, y);
+        assert(check);
+      }
+    }
+  }
+
+  // Without the memoized results the next step rebuilds them
+  hashlife.collect(false);
+  OriginalConway(original, next, padded_width, padded_height);
+  std::swap(original, next);
+
+  hashlife.setStepLog2(0);
+  hashlife.step();
+  hashlife.store(reinterpret_cast<u_byte *>(window.data()), static_cast<u32>(width), static_cast<u32>(height));
+  for (s32 y = 0; y < height; y++)
+    for (s32 x = 0; x < width; x++)
+      assert(original[ARRAY_2D_INDEX(x + padding, y + padding, padded_width)].a == window[ARRAY_2D_INDEX(x, y, width)].a);
+}
+
+int main(int, char **)
+{
+  srand(static_cast<u32>(time(NULL)));
+
+  Check(64, 64, 0, 20, 0);
+  Check(37, 50, 1, 10, 0);
+  Check(64, 48, 3, 6, 0);
+  Check(40, 40, 5, 2, 0);
+
+  // Collected after every step
+  Check(64, 64, 0, 20, 1);
+  Check(37, 50, 2, 8, 1);
+  Check(40, 40, 4, 3, 1);
+
+  fprintf(stdout, "All correct\n");
+  return 0;
+}
@@ -0,0 +1,65 @@
+#include "engine/engine.h"
+#include "automaton.h"
+
+#ifndef __AUTOMATA_REGISTRY_H__
+#define __AUTOMATA_REGISTRY_H__ 1
+
+// Owns every registered automaton and routes the frame calls to the active
+// one, so main, headless runs and benchmarks never need to know the types.
+// An automaton only compiles and allocates when it is first selected, the
+// idle ones are released, least recently used first, while the total goes
+// over the memory budget.
+class AutomataRegistry
+{
+public:
+  AutomataRegistry();
+  ~AutomataRegistry();
+
+  template <typename T>
+  T *add()
+  {
+    automata_.push_back(std::make_unique<T>());
+    last_used_.push_back(0);
+    return static_cast<T *>(automata_.back().get());
+  }
+
+  // Only the active automaton is initialized
+  void init(Math::Vec2 win);
+
+  void update();
+  void imgui();
+  void reset();
+  void reload(); // Every automaton already compiled, see Automaton::reload
+
+  // Grid of the active automaton, the others follow when selected
+  boolean resize(u32 width, u32 height);
+
+  void setBudget(size_t bytes);
+  size_t budget();
+  size_t gpuBytes(); // Held by all the automata
+
+  void select(s32 mode);
+  void next();
+  void prev();
+
+  Automaton *active();
+  Automaton *get(u32 index);
+  Automaton *find(const char *name);
+  s32 mode();
+  u32 count();
+
+private:
+  void activate();
+  void trim();
+
+  std::vector<std::unique_ptr<Automaton>> automata_;
+  std::vector<u64> last_used_; // Selection stamp of each automaton
+  u64 clock_;
+  size_t budget_;
+  s32 budget_mb_; // ImGui edit
+  s32 mode_;
+  u32 width_, height_;
+  s32 grid_input_[2]; // ImGui edit, applied on demand
+};
+
+#endif /* __AUTOMATA_REGISTRY_H__ */
@@ -0,0 +1,174 @@
+#include "engine/engine.h"
+#include "gpu_timer.h"
+#include "gpu_stats.h"
+#include "checkpoint_writer.h"
+#include "defines.h"
+
+#ifndef __AUTOMATON_H__
+#define __AUTOMATON_H__ 1
+
+// Common base of every automaton. Owns the ping-pong textures, the generation
+// counter and the update timing, the derived classes only compile their
+// programs and record their passes in step(), each wrapped in
+// gpu_timer_.begin/end to show its GPU time.
+// Nothing touches the GPU before init(), and release() gives back the
+// textures and buffers while keeping the compiled programs.
+class Automaton
+{
+public:
+  enum class Seed
+  {
+    Binary,     // 40% of the cells alive
+    Continuous, // Random alpha in [0, 255)
+  };
+
+  Automaton(const char *name, Seed seed);
+  virtual ~Automaton();
+
+  void init(Math::Vec2 win);
+  void release();
+  boolean resident();
+
+  // A program did not build, update() records nothing until a reload links
+  boolean failed();
+
+  // Rebuilds the programs from the files without waiting, the old ones keep
+  // running until every new one links and stay if any fails
+  void reload();
+
+  // Reallocates the textures and every GPU resource and reseeds,
+  // false if the size is out of [MIN_GRID_SIZE, GL_MAX_TEXTURE_SIZE]
+  boolean resize(u32 width, u32 height);
+
+  // Records a batch of generations without waiting for the GPU, false if
+  // nothing was recorded because SIM_FRAMES_IN_FLIGHT batches are still
+  // running, the target rate needs no generation yet or failed()
+  boolean update();
+  void imgui();
+
+  // Generations batched per update(), target Hz 0 keeps the fixed count
+  void setGenerationsPerFrame(u32 generations);
+  void setTargetHz(f32 hz);
+
+  // Seeds both textures on the GPU from seed(), the same seed and size give
+  // the same state
+  void reset();
+  void clean();
+
+  void setSeed(u32 seed);
+  u32 seed();
+
+  // Statistics of the last generation of every update, reduced on the GPU.
+  // Batched updates (setGenerationsPerFrame, setTargetHz) skip the ones in
+  // between, every generation is only measured at one per update. stats()
+  // lags a few updates behind, check its generation
+  void setStats(boolean enabled);
+  boolean statsEnabled();
+  boolean statsReady();
+  const GPUStats::Result &stats();
+
+  // Generations stepped with the statistics on that were measured and that
+  // were not, the ones inside a batch and the updates that found every
+  // STATS_FRAMES buffer in flight. Missed > 0 means the series has holes
+  u64 statsMeasured();
+  u64 statsMissed();
+
+  // Grid, parameters, generation and seed to a versioned file, see
+  // Snapshot. The binary automata take 1 bit per cell. load() maps the
+  // file, resizes the grid to it and decodes the cells on the GPU
+  boolean save(const std::string &path, u32 compression = SNAPSHOT_RLE);
+  boolean load(const std::string &path);
+
+  // Snapshot every interval generations written in the background, see
+  // CheckpointWriter. Interval 0 turns them off
+  void setCheckpoints(const std::string &directory, u64 interval, u32 keep = CHECKPOINT_KEEP, u32 compression = SNAPSHOT_RLE);
+  const std::string &lastCheckpoint();
+
+  u32 currentTexture();
+  u32 width();
+  u32 height();
+  u64 generation();
+  size_t updateTime(); // CPU mcs spent recording the last update()
+  size_t gpuTime();    // GPU mcs of the first step of the last update the GPU finished
+  size_t gpuBytes();   // Textures and buffers held, 0 when released
+  const char *name();
+
+protected:
+  virtual void compileShaders() = 0;
+  virtual void initResources() {}    // Buffers for width_ x height_, before the seed
+  virtual void releaseResources() {} // Undo initResources, on release and resize
+  virtual size_t resourceBytes() { return 0; }
+  virtual void step() = 0;
+  virtual u64 generationsPerStep() { return 1; }
+  virtual void imguiParams() {}
+  virtual void uploaded() {} // New state written to the textures by reset/clean
+  virtual void present() {}                 // Called before currentTexture() is handed out
+  virtual void saveParams(std::vector<f32> &) {}       // Tunables stored in snapshots
+  virtual void loadParams(const std::vector<f32> &) {} // Fewer values than saved when loading an older layout
+  virtual boolean pingPong() { return true; }          // False when the state lives elsewhere, prev_data_id_ is then 0
+
+  // current_data_id_, and prev_data_id_ while pingPong(), call when it changes
+  void allocateTextures();
+
+  // Called from compileShaders for each program, so reload() can rebuild it
+  void buildProgram(u32 &program, const std::string &source, const char *name);
+
+  void bindImages();
+  void dispatch(u32 groups_x, u32 groups_y, u32 groups_z = 1);
+  void dispatchCells(u32 cells_x, u32 cells_y); // X_THREADS * Y_THREADS groups covering the cells
+
+  TimeCont update_timer_;
+  GPUTimer gpu_timer_;
+  u64 loops_;
+
+  u32 width_, height_;
+
+  u32 prev_data_id_, current_data_id_;
+
+private:
+  void swap();
+  boolean validSize(u32 width, u32 height);
+  void compileCommon();
+  void seedTextures(s32 mode);
+  u64 frameGenerations();
+  void clearFences();
+  void pollReload();
+  Snapshot::Header snapshotHeader(u32 compression, std::vector<f32> &params); // Without data_size
+
+  const char *name_;
+  Seed seed_;
+  u32 seed_value_;
+  u32 seed_program_;
+  boolean compiled_;
+
+  GPUStats stats_;
+  u32 stats_program_;
+  boolean stats_enabled_;
+  u64 stats_measured_, stats_missed_;
+
+  u32 restore_program_, store_program_;
+  s32 snapshot_compression_; // ImGui edit
+  CheckpointWriter checkpoints_;
+
+  struct Reload
+  {
+    u32 *program; // Member replaced once every reload links
+    u32 next;
+    std::string cache_path;
+    const char *name;
+  };
+  std::vector<Reload> reloads_;
+  boolean reloading_;
+  u32 failed_programs_; // Since the last successful build, the automaton does not step
+
+  s32 generations_per_frame_;
+  f32 target_hz_;
+  f64 pending_generations_; // Owed by the target rate, fraction included
+  TimeCont frame_timer_;
+  boolean frame_timed_;
+
+  GLsync fences_[SIM_FRAMES_IN_FLIGHT];
+  u32 fence_index_;
+};
+
+#endif /* __AUTOMATON_H__ */
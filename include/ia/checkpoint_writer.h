@@ -0,0 +1,68 @@
+#include "engine/engine.h"
+#include "snapshot.h"
+#include "defines.h"
+
+#ifndef __CHECKPOINT_WRITER_H__
+#define __CHECKPOINT_WRITER_H__ 1
+
+// Periodic snapshots that never hold the simulation. store_cs.glsl packs
+// the cells on the GPU into a buffer, read once its fence signals into one
+// of two host slots, and a TaskManager worker compresses and writes that
+// slot while the next capture can fill the other. A checkpoint is skipped,
+// not waited for, while the copy or both slots are still busy. Only the
+// newest keep files of the automaton are left in the directory.
+class CheckpointWriter
+{
+public:
+  CheckpointWriter();
+  ~CheckpointWriter();
+
+  // interval 0 turns the checkpoints off
+  void configure(const std::string &directory, u64 interval, u32 keep, u32 compression);
+  u64 interval();
+  u32 keep();
+  u32 compression();
+
+  // True once generation reaches the next multiple of the interval
+  boolean due(u64 generation);
+
+  // header without data_size, the cells of texture are packed by program
+  void capture(u32 program, u32 texture, const Snapshot::Header &header, const std::vector<f32> &params);
+  void poll(); // Hands the finished copy to a worker
+
+  u64 written();
+  u64 skipped();
+  const std::string &last(); // Path of the newest checkpoint written
+
+  // Waits for the writes, the copy in flight is lost
+  void release();
+
+private:
+  struct Slot
+  {
+    Snapshot::Header header;
+    std::vector<f32> params;
+    std::vector<u_byte> cells;
+    std::future<boolean> result;
+  };
+
+  static boolean Write(Slot *slot, std::string path, std::string directory, std::string prefix, u32 keep);
+  void finish(boolean wait);
+
+  std::string directory_;
+  u64 interval_, next_;
+  u32 keep_, compression_;
+
+  u32 buffer_;
+  size_t buffer_size_;
+  GLsync fence_;
+  Snapshot::Header pending_header_;
+  std::vector<f32> pending_params_;
+
+  Slot slots_[2];
+  std::string last_, writing_[2];
+  u64 last_generation_;
+  u64 written_, skipped_;
+};
+
+#endif /* __CHECKPOINT_WRITER_H__ */
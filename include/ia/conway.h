@@ -1,35 +1,65 @@
 #include "engine/engine.h"
+#include "automaton.h"
+#include "conway_cpu.h"
+#include "hashlife.h"
 
 #ifndef __CONWAY_H__
 #define __CONWAY_H__ 1
 
-class Conway
+class Conway : public Automaton
 {
 public:
+  enum class Backend
+  {
+    Texture,  // conway_cs.glsl over the RGBA8 textures
+    Tiled,    // Shared memory tiles, several generations per dispatch
+    Packed,   // 32 cells per uint in SSBOs, unpacked to one texture only when presented
+    CPU,      // Bit-packed ConwayCPU, uploaded to one texture only when presented
+    Hashlife, // Unbounded quadtree, 2^k generations per update
+  };
+
   Conway();
-  void init(Math::Vec2 win);
   ~Conway();
 
-  void update();
-  void imgui();
+  void setBackend(Backend backend);
+  Backend backend();
 
-  void reset();
-  void clean();
+  // Hashlife generations per update as 2^k
+  void setStepLog2(u32 k);
 
-  u32 currentTexture();
+  // Tiled generations per dispatch, up to MAX_TEMPORAL_STEPS
+  void setTemporalSteps(s32 steps);
 
 private:
-  void compileShaders();
-  void swap();
-
-  TimeCont update_timer_;
-  u32 loops_;
+  void compileShaders() override;
+  void initResources() override;
+  void releaseResources() override;
+  size_t resourceBytes() override;
+  void step() override;
+  void imguiParams() override;
+  void saveParams(std::vector<f32> &params) override;
+  void loadParams(const std::vector<f32> &params) override;
+  void uploaded() override;
+  void present() override;
+  u64 generationsPerStep() override;
+  boolean pingPong() override;
 
-  u32 compute_program_;
+  void initPacked();
+  void pack();
+  void uploadPackedUniforms(u32 program);
 
-  u32 width_, height_;
+  u32 compute_program_, tiled_program_;
+  s32 temporal_steps_;
+  u32 packed_program_, pack_program_, unpack_program_;
+  u32 packed_prev_ssbo_, packed_curr_ssbo_;
+  u32 words_;
 
-  u32 prev_data_id_, current_data_id_;
+  Backend backend_;
+  ConwayCPU cpu_;
+  Hashlife hashlife_;
+  s32 hashlife_mb_;
+  std::vector<u_byte> staging_;
+  boolean dirty_;
 };
 
 #endif /* __CONWAY_H__ */
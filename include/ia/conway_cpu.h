@@ -0,0 +1,38 @@
+#include "engine/engine.h"
+
+#ifndef __CONWAY_CPU_H__
+#define __CONWAY_CPU_H__ 1
+
+// Bit-packed Conway kernel, 64 cells per u64 and the neighbour count done with
+// bitwise adders (AVX2 when the compiler targets it). Cells outside the grid
+// are dead, same as imageLoad out of bounds in conway_cs.glsl.
+class ConwayCPU
+{
+public:
+  ConwayCPU();
+  ~ConwayCPU();
+
+  void init(u32 width, u32 height);
+
+  void step();
+
+  // RGBA8 images, alpha > 127 means alive
+  void load(const u_byte *rgba);
+  void store(u_byte *rgba);
+
+  u64 population();
+
+private:
+  void stepRows(u32 begin, u32 end);
+  u64 *row(std::vector<u64> &grid, u32 y);
+
+  // Rows padded with a zero word on each side plus a zero row above and
+  // below, so the kernel never branches on the borders
+  std::vector<u64> prev_, current_;
+
+  u32 width_, height_;
+  u32 words_, stride_;
+  u64 last_mask_;
+};
+
+#endif /* __CONWAY_CPU_H__ */
@@ -7,18 +7,23 @@
 #define CURR_IMG_BIND 1
 #define COUNTER_BIND 2
 #define INDICES_BIND 3
-
-#define SECTORS 4
+#define PACKED_PREV_BIND 4
+#define PACKED_CURR_BIND 5
+#define SPECTRUM_BIND 6
+#define KERNEL_BIND 7
+#define WEIGHTS_BIND 8
+#define GROWTH_BIND 9
+#define STATS_BIND 10
+#define SNAPSHOT_BIND 11
 
 #define MAX_RADIUS 20
 #define O_RADIUS 12.0f
 #define I_RADIUS 1.44f
 
-#define NEAR_NEIGHBORS 6
-
-#define C_WIDTH 1024
+#define C_WIDTH 1024  // Default grid, the size is chosen at runtime
 #define C_HEIGHT 1024
-#define C_DEPTH (static_cast<s32>(NEAR_NEIGHBORS + (O_RADIUS * SECTORS)))
+#define MIN_GRID_SIZE 64 // Keeps the widest kernels from wrapping twice
+#define VRAM_BUDGET_MB 256 // Idle automata are released past this total
 #define TOTAL_LINES(rad) (static_cast<u32>((rad * 2) + 1))
 #define TOTAL_COLUMNS(rad) (static_cast<u32>((rad * 2) + 1))
 
@@ -44,29 +49,112 @@ struct Counter
 #define Y_THREADS 8 // May need to be 4
 #define Z_THREADS 1
 
+#define TILE_SIZE 16          // Tiled Conway workgroup side
+#define MAX_TEMPORAL_STEPS 8  // Tiled Conway generations per dispatch
+
+#define FFT_THREADS 256   // Lenia FFT workgroup, one row or column each
+#define MAX_FFT_SIZE 1024 // Two shared buffers of vec2, 16 KB
+
+#define GROWTH_LUT_SIZE 4096 // Lenia growth samples on [0, 1]
+
+#define LENIA_OP_BAND 128 // LeniaOp output rows per counter pass
+
+#define SCAN_THREADS 256 // SmoothLife scan workgroup, SCAN_THREADS * 2 values per block
+
+#define SEED_CLEAR 0 // seed_cs.glsl modes, clear is only used without glClearTexImage
+#define SEED_BINARY 1
+#define SEED_CONTINUOUS 2
+
+#define STATS_ROWS 4      // Cells per thread of the statistics pass, Y_THREADS apart
+#define STATS_BINS 16     // State histogram, 256 / STATS_BINS alpha values each
+#define STATS_FRAMES 4    // Statistics buffers in flight before one is skipped
+#define STATS_POPULATION 0 // Offsets in the statistics buffer, 64 bit sums as lo, hi
+#define STATS_MASS 1
+#define STATS_MOMENT_X 3
+#define STATS_MOMENT_Y 5
+#define STATS_HISTOGRAM 7
+#define STATS_VALUES (STATS_HISTOGRAM + STATS_BINS)
+
+#define SNAPSHOT_MAGIC "IASN" // First bytes of a snapshot file
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_DIR "snapshots/" // Relative to the working directory
+#define SNAPSHOT_BITS 0           // Cell encodings, 1 bit per cell or the 8 bit alpha
+#define SNAPSHOT_BYTES 1
+#define SNAPSHOT_RAW 0 // Payload compressions
+#define SNAPSHOT_RLE 1
+#define SNAPSHOT_DELTA_RLE 2 // Bytes minus the previous one, then RLE
+#define SNAPSHOT_THREADS 64  // store_cs.glsl workgroup, one word per invocation
+#define CHECKPOINT_DIR "checkpoints/" // Relative to the working directory
+#define CHECKPOINT_KEEP 3              // Newest checkpoints left per automaton
+
+#define GPU_TIMER_FRAMES 4     // Updates in flight before a timer query is reused
+#define MAX_GPU_TIMER_QUERIES 32 // Per update, a pass repeated in a loop adds up its queries
+
+#define SHADER_CACHE_DIR "shader_cache/" // Program binaries, relative to the working directory
+#define VARIANT_SETTLE_UPDATES 30        // Unchanged parameters before a specialized program is built
+#define MAX_SHADER_VARIANTS 16           // Specialized programs kept per shader
+#define MAX_SHADER_CACHE_FILES 256       // Least recently used binaries are deleted past this count
+
+#define MAX_GENERATIONS_PER_FRAME 1024 // Batched by a single update()
+#define SIM_FRAMES_IN_FLIGHT 2         // Updates queued before update() skips
+
+#define CAPTURE_PBOS 3       // Frame captures in flight, mapped once their fence signals
+#define CAPTURE_QUEUE_SIZE 8 // Captured frames waiting for or held by the consumer
+
+#define EXPORT_FRAMES_IN_FLIGHT (CAPTURE_QUEUE_SIZE - CAPTURE_PBOS) // Encoding, the rest are left to the captures
+#define EXPORT_DIR "capture/"                                      // Relative to the working directory
+
 const char defines[] = R"(
-#version 460
+#version 430
 
 #define X_THREADS 8
 #define Y_THREADS 8 // May need to be 4
 #define Z_THREADS 1
 
+#define TILE_SIZE 16
+#define MAX_TEMPORAL_STEPS 8
+
+#define FFT_THREADS 256
+#define MAX_FFT_SIZE 1024
+
+#define GROWTH_LUT_SIZE 4096
+
+#define SCAN_THREADS 256
+
+#define SEED_CLEAR 0
+#define SEED_BINARY 1
+#define SEED_CONTINUOUS 2
+
+#define STATS_ROWS 4
+#define STATS_BINS 16
+#define STATS_POPULATION 0
+#define STATS_MASS 1
+#define STATS_MOMENT_X 3
+#define STATS_MOMENT_Y 5
+#define STATS_HISTOGRAM 7
+#define STATS_VALUES (STATS_HISTOGRAM + STATS_BINS)
+
+#define SNAPSHOT_BITS 0
+#define SNAPSHOT_BYTES 1
+#define SNAPSHOT_THREADS 64
+
 #define PREV_IMG_BIND 0
 #define CURR_IMG_BIND 1
 #define COUNTER_BIND 2
 #define INDICES_BIND 3
-
-#define SECTORS 4
+#define PACKED_PREV_BIND 4
+#define PACKED_CURR_BIND 5
+#define SPECTRUM_BIND 6
+#define KERNEL_BIND 7
+#define WEIGHTS_BIND 8
+#define GROWTH_BIND 9
+#define STATS_BIND 10
+#define SNAPSHOT_BIND 11
 
 #define MAX_RADIUS 20
 #define O_RADIUS 12.0
 #define I_RADIUS 1.44
 
-#define NEAR_NEIGHBORS 6
-
-#define C_WIDTH 1024
-#define C_HEIGHT 1024
-#define C_DEPTH int(NEAR_NEIGHBORS + (O_RADIUS * SECTORS))
 #define TOTAL_LINES(rad) ((rad * 2) + 1)
 #define TOTAL_COLUMNS(rad) ((rad * 2) + 1)
 
@@ -0,0 +1,35 @@
+#include "engine/engine.h"
+#include <complex>
+
+#ifndef __FFT_H__
+#define __FFT_H__ 1
+
+// Complex FFT of any length, Stockham autosort with radix 4, 2, 3, 5 passes
+// and a generic pass for the remaining prime factors. The plan is read only
+// once built, so one FFT can be shared by several threads, each one with its
+// own scratch buffer.
+class FFT
+{
+public:
+  typedef std::complex<f32> Complex;
+
+  FFT();
+  ~FFT();
+
+  void init(u32 size);
+  u32 size();
+
+  // In place, scratch must hold size() values. The inverse is not scaled.
+  void forward(Complex *data, Complex *scratch);
+  void inverse(Complex *data, Complex *scratch);
+
+private:
+  void transform(Complex *data, Complex *scratch, boolean inverse);
+  void pass(const Complex *src, Complex *dst, u32 radix, u32 span, boolean inverse);
+
+  u32 size_;
+  std::vector<u32> factors_;
+  std::vector<Complex> twiddles_; // exp(-2 pi i k / size)
+};
+
+#endif /* __FFT_H__ */
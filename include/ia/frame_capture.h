@@ -0,0 +1,66 @@
+#include "engine/engine.h"
+#include "spsc_queue.h"
+#include "defines.h"
+
+#ifndef __FRAME_CAPTURE_H__
+#define __FRAME_CAPTURE_H__ 1
+
+struct CapturedFrame
+{
+  std::vector<u_byte> pixels; // RGBA, width * height * 4 bytes
+  u32 width, height;
+  u64 generation;
+};
+
+// Copies textures into a ring of CAPTURE_PBOS pixel buffers with
+// glGetTexImage, which returns as soon as the copy is queued. A buffer is
+// only mapped once its fence signals, a few frames later, so neither side
+// waits for the other. A capture is dropped, not waited for, while every
+// buffer is in flight or every frame is held by the consumer.
+//
+// The frames go to a lock-free queue, the GL thread produces and a single
+// consumer thread pops and recycles them.
+class FrameCapture
+{
+public:
+  FrameCapture();
+  ~FrameCapture();
+
+  // GL thread, collects the finished copies and queues this one
+  void capture(u32 texture, u32 width, u32 height, u64 generation);
+  void poll(); // Collects without capturing
+
+  // Consumer thread, every popped frame goes back through recycle()
+  CapturedFrame *pop();
+  void recycle(CapturedFrame *frame);
+
+  u64 captured(); // Frames handed to the queue
+  u64 dropped();
+
+  // GL thread, the copies in flight are lost. Frames the consumer still
+  // holds stay valid until the FrameCapture is destroyed
+  void release();
+
+private:
+  struct Buffer
+  {
+    u32 pbo;
+    size_t size;
+    GLsync fence;
+    u32 width, height;
+    u64 generation;
+  };
+
+  Buffer buffers_[CAPTURE_PBOS];
+  u32 current_;
+
+  // One slot is always empty, the queues hold every frame of the pool
+  std::unique_ptr<CapturedFrame> pool_[CAPTURE_QUEUE_SIZE];
+  SPSCQueue<CapturedFrame *, CAPTURE_QUEUE_SIZE + 1> ready_;
+  SPSCQueue<CapturedFrame *, CAPTURE_QUEUE_SIZE + 1> free_;
+  CapturedFrame *spare_; // GL thread, popped from free_ but not filled, only the consumer pushes to free_
+
+  std::atomic<u64> captured_, dropped_;
+};
+
+#endif /* __FRAME_CAPTURE_H__ */
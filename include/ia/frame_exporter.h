@@ -0,0 +1,56 @@
+#include "engine/engine.h"
+#include "frame_capture.h"
+#include "defines.h"
+
+#ifndef __FRAME_EXPORTER_H__
+#define __FRAME_EXPORTER_H__ 1
+
+// Writes the frames of a FrameCapture as an image sequence, one file per
+// generation, encoded on the TaskManager workers. At most
+// EXPORT_FRAMES_IN_FLIGHT frames are encoding, saturated() tells the
+// producer to hold the simulation until pump() hands some back. Without it
+// the capture drops frames instead of growing a backlog.
+class FrameExporter
+{
+public:
+  enum class Format
+  {
+    PNG, // 8 bit gray of the state, <generation>.png
+    Raw, // State bytes only, <generation>_<width>x<height>.r8
+  };
+
+  FrameExporter();
+  ~FrameExporter();
+
+  // Every frame popped from capture until stop() is written to directory
+  boolean start(FrameCapture *capture, const std::string &directory, Format format);
+  void stop(); // Writes the queued frames and waits for them
+  boolean running();
+
+  // From the consumer thread of the capture, recycles the encoded frames
+  // and hands new ones to the workers
+  void pump();
+  boolean saturated();
+
+  u64 written();
+  u64 failed();
+
+private:
+  struct Job
+  {
+    CapturedFrame *frame;
+    std::future<boolean> result;
+  };
+
+  static boolean Encode(const CapturedFrame *frame, const std::string &path, Format format);
+  void finish(boolean wait);
+
+  FrameCapture *capture_;
+  std::string directory_;
+  Format format_;
+
+  std::vector<Job> jobs_;
+  u64 written_, failed_;
+};
+
+#endif /* __FRAME_EXPORTER_H__ */
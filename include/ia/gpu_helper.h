@@ -6,9 +6,26 @@
 class GPUHelper
 {
 public:
-  static u32 CreateTexture(u32 width, u32 height, u_byte *data);
-  static u32 CompileShader(u32 shader_type, const byte *source, const char *name);
-  static u32 CreateProgram(u32 compute_shader, const char *name);
+  static u32 CreateTexture(u32 width, u32 height); // Immutable RGBA8 storage, undefined content
+
+  // Compute program from the full source (defines included), 0 if it does
+  // not compile. The linked binary is cached in SHADER_CACHE_DIR keyed by a
+  // hash of the source and the driver, a miss or a binary the driver rejects
+  // compiles from source.
+  static u32 CreateComputeProgram(const std::string &source, const char *name);
+
+  // Same in steps, Start returns at once and Done never waits when the
+  // driver compiles in parallel (KHR/ARB_parallel_shader_compile). Finish
+  // returns the program or 0 if it failed, and deletes it in that case.
+  // cache_path is left empty when the binary came from the cache.
+  static u32 StartComputeProgram(const std::string &source, std::string &cache_path);
+  static boolean ComputeProgramDone(u32 program);
+  static u32 FinishComputeProgram(u32 program, const std::string &cache_path, const char *name);
+
+  // Empty if the driver has no binary formats
+  static std::string ProgramCachePath(const std::string &source);
+  static u32 LoadProgramBinary(const std::string &path); // 0 if missing or rejected
+  static void SaveProgramBinary(u32 program, const std::string &path);
 
 private:
   GPUHelper();
@@ -0,0 +1,58 @@
+#include "engine/engine.h"
+#include "defines.h"
+
+#ifndef __GPU_STATS_H__
+#define __GPU_STATS_H__ 1
+
+// Population, mass, centroid and state histogram of the grid, reduced on the
+// GPU by stats_cs.glsl into a buffer of STATS_VALUES words instead of reading
+// the texture back. As in GPUTimer the buffers are kept in a ring of
+// STATS_FRAMES and only read once their fence signals, so the CPU never
+// waits and the results lag a few updates behind.
+class GPUStats
+{
+public:
+  struct Result
+  {
+    u64 generation;
+    u32 population;             // Cells with a state above 0
+    f64 mass;                   // Sum of the states, each in [0, 1]
+    f64 centroid_x, centroid_y; // Mass weighted, in cells
+    u32 histogram[STATS_BINS];
+    u64 time; // ns of the pass
+  };
+
+  GPUStats();
+  ~GPUStats();
+
+  // defines with the subgroup extensions enabled, then stats_cs.glsl
+  static std::string Source();
+
+  // Collects the finished passes and reduces the alpha of texture, false
+  // when skipped because every buffer is still in flight
+  boolean record(u32 program, u32 texture, u32 width, u32 height, u64 generation);
+
+  boolean ready(); // A result was collected since the last release
+  const Result &last();
+
+  void release();
+
+private:
+  struct Frame
+  {
+    u32 buffer;
+    u32 query;
+    GLsync fence;
+    u64 generation;
+  };
+
+  void collect();
+
+  Frame frames_[STATS_FRAMES];
+  u32 current_;
+
+  Result last_;
+  boolean ready_;
+};
+
+#endif /* __GPU_STATS_H__ */
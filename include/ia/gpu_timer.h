@@ -0,0 +1,51 @@
+#include "engine/engine.h"
+#include "defines.h"
+
+#ifndef __GPU_TIMER_H__
+#define __GPU_TIMER_H__ 1
+
+// GL_TIME_ELAPSED queries around the passes of an update, kept in a ring of
+// GPU_TIMER_FRAMES updates and read back only once the GPU finished them, so
+// the CPU never waits. The times shown lag a few updates behind.
+class GPUTimer
+{
+public:
+  GPUTimer();
+  ~GPUTimer();
+
+  // Collects the finished updates and starts recording a new one
+  void beginFrame();
+  void endFrame();
+
+  // One query per call, passes can not nest. Calls with the same name in an
+  // update add up, past MAX_GPU_TIMER_QUERIES they are not timed
+  void begin(const char *pass);
+  void end();
+
+  size_t passes();
+  const char *passName(size_t pass);
+  u64 passTime(size_t pass); // ns of the pass in the last finished update
+  u64 total();               // ns of the last finished update
+
+  void release();
+
+private:
+  struct Frame
+  {
+    u32 queries[MAX_GPU_TIMER_QUERIES];
+    const char *names[MAX_GPU_TIMER_QUERIES];
+    u32 count;
+    boolean pending;
+  };
+
+  void collect();
+
+  Frame frames_[GPU_TIMER_FRAMES];
+  u32 current_;
+  boolean recording_, open_;
+
+  std::vector<const char *> names_;
+  std::vector<u64> times_;
+};
+
+#endif /* __GPU_TIMER_H__ */
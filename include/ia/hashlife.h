@@ -0,0 +1,76 @@
+#include "engine/engine.h"
+
+#ifndef __HASHLIFE_H__
+#define __HASHLIFE_H__ 1
+
+// Conway on a hash-consed quadtree with memoized results (Gosper's Hashlife).
+// Every step() advances 2^k generations. The universe is unbounded, the grid
+// given to load()/store() is only the window at the origin, so cells leaving
+// the window keep living instead of dying on the border like the shaders do.
+class Hashlife
+{
+public:
+  Hashlife();
+  ~Hashlife();
+
+  void load(const u_byte *rgba, u32 width, u32 height);
+  void store(u_byte *rgba, u32 width, u32 height);
+
+  void step();
+
+  void setStepLog2(u32 k);
+  u32 stepLog2();
+
+  // Soft limit, checked after every step. Exceeding it runs a collection
+  // that keeps the memoized results and, if that is not enough, drops them.
+  void setMaxBytes(size_t bytes);
+  void collect(boolean keep_results);
+
+  u64 population();
+  size_t nodes();
+  size_t bytes();
+
+private:
+  struct Node
+  {
+    Node *nw_, *ne_, *sw_, *se_;
+    Node *result_; // Center advanced 2^min(k, level - 2), valid for step_log2_
+    Node *next_;   // Hash chain or free list
+    u64 population_;
+    u32 level_;
+    u32 marked_;
+  };
+
+  Node *allocate();
+  Node *join(Node *nw, Node *ne, Node *sw, Node *se);
+  Node *empty(u32 level);
+  Node *centre(Node *node);
+  Node *inner(Node *node);
+  Node *life4x4(Node *node);
+  Node *successor(Node *node, u32 j);
+
+  Node *build(const u_byte *rgba, u32 width, u32 height, s64 x, s64 y, u32 level);
+  void fill(Node *node, u_byte *rgba, u32 width, u32 height, s64 x, s64 y);
+
+  void rehash(size_t buckets);
+  void mark(Node *node, boolean keep_results);
+  void clearResults();
+  void clear();
+
+  std::vector<std::unique_ptr<Node[]>> blocks_;
+  Node *free_list_;
+
+  std::vector<Node *> buckets_;
+  size_t count_;
+
+  Node dead_, alive_;
+  std::vector<Node *> empties_;
+
+  Node *root_;
+  s64 origin_x_, origin_y_;
+
+  u32 step_log2_;
+  size_t max_bytes_;
+};
+
+#endif /* __HASHLIFE_H__ */
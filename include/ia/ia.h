@@ -2,6 +2,10 @@
 #define __IA_H__ 1
 
 #include "defines.h"
+#include "automaton.h"
+#include "automata_registry.h"
+#include "frame_capture.h"
+#include "frame_exporter.h"
 #include "conway.h"
 #include "smooth_life.h"
 #include "lenia.h"
@@ -1,22 +1,27 @@
 #include "engine/engine.h"
+#include "automaton.h"
+#include "lenia_tables.h"
+#include "lenia_fft.h"
+#include "shader_variants.h"
 
 #ifndef __LENIA_H__
 #define __LENIA_H__ 1
 
-class Lenia
+class Lenia : public Automaton
 {
 public:
+  enum class Backend
+  {
+    Texture, // lenia_cs.glsl, (2R + 1)^2 taps per cell
+    CPUFFT,  // LeniaFFT on the TaskManager, uploaded only when presented
+    GPUFFT,  // Compute shader FFT, power of two sizes up to MAX_FFT_SIZE
+  };
+
   Lenia();
-  void init(Math::Vec2 win);
   ~Lenia();
 
-  void update();
-  void imgui();
-
-  void reset();
-  void clean();
-
-  u32 currentTexture();
+  void setBackend(Backend backend);
+  Backend backend();
 
   float radius_;
   float dt_;
@@ -26,17 +31,32 @@ public:
   float omega_;
   
 private:
-  void compileShaders();
-  void swap();
-
-  TimeCont update_timer_;
-  u32 loops_;
+  void compileShaders() override;
+  void initResources() override;
+  void releaseResources() override;
+  size_t resourceBytes() override;
+  void step() override;
+  void imguiParams() override;
+  void saveParams(std::vector<f32> &params) override;
+  void loadParams(const std::vector<f32> &params) override;
+  void uploaded() override;
+  void present() override;
+
+  boolean initGPUFFT();
+  f32 maxRadius(); // The texture kernel is (2R + 1)^2 taps, the FFT cost does not depend on it
+  void uploadFFTUniforms(u32 program);
 
   u32 compute_program_;
-
-  u32 width_, height_;
-
-  u32 prev_data_id_, current_data_id_;
+  LeniaTables tables_;
+  ShaderVariants variants_; // compute_program_ with the radius and weights folded in
+  boolean specialize_, specialized_;
+  u32 fft_rows_program_, fft_columns_program_, fft_growth_program_;
+  u32 spectrum_ssbo_, kernel_ssbo_;
+
+  Backend backend_;
+  LeniaFFT fft_;
+  std::vector<u_byte> staging_;
+  boolean dirty_;
 };
 
 #endif /* __LENIA_H__ */
@@ -0,0 +1,53 @@
+#include "engine/engine.h"
+#include "fft.h"
+
+#ifndef __LENIA_FFT_H__
+#define __LENIA_FFT_H__ 1
+
+// Lenia with the convolution done in frequency space, O(N log N) per
+// generation whatever the radius. Same kernel and wrapping as lenia_cs.glsl,
+// the state is kept in f32 and only quantized by store().
+class LeniaFFT
+{
+public:
+  typedef FFT::Complex Complex;
+
+  LeniaFFT();
+  ~LeniaFFT();
+
+  void init(u32 width, u32 height);
+
+  // The kernel spectrum is only rebuilt when a parameter changed, returns
+  // true if it was
+  boolean setKernel(f32 radius, f32 rho, f32 omega);
+
+  // height rows of width / 2 + 1 values, scaled by 1 / (width * height)
+  const std::vector<Complex> &kernel();
+
+  void step(f32 dt, f32 mu, f32 sigma);
+
+  // RGBA8 images, the state is the alpha channel
+  void load(const u_byte *rgba);
+  void store(u_byte *rgba);
+
+private:
+  void forwardRows(const f32 *src, std::vector<Complex> &spectrum, u32 begin, u32 end);
+  void columns(std::vector<Complex> &spectrum, u32 begin, u32 end, boolean convolve);
+  void growthRows(u32 begin, u32 end, f32 dt, f32 mu, f32 sigma);
+
+  // Splits [0, count) in bands for the TaskManager workers
+  void parallel(u32 count, const std::function<void(u32, u32)> &task);
+
+  u32 width_, height_;
+  u32 half_; // Columns kept of every row spectrum, width / 2 + 1
+
+  FFT rows_fft_, columns_fft_;
+
+  std::vector<f32> state_;
+  std::vector<Complex> spectrum_; // height_ rows of half_ values
+  std::vector<Complex> kernel_;   // Same layout, scaled by 1 / (width * height)
+
+  f32 radius_, rho_, omega_;
+};
+
+#endif /* __LENIA_FFT_H__ */
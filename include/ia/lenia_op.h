@@ -1,24 +1,18 @@
 #include "engine/engine.h"
+#include "automaton.h"
+#include "lenia_tables.h"
+#include "shader_variants.h"
 #include "defines.h"
 
 #ifndef __LENIA_OP_H__
 #define __LENIA_OP_H__ 1
 
-class LeniaOp
+class LeniaOp : public Automaton
 {
 public:
   LeniaOp();
-  void init(Math::Vec2 win);
   ~LeniaOp();
 
-  void update();
-  void imgui();
-
-  void reset();
-  void clean();
-
-  u32 currentTexture();
-
   s32 radius_;
   float dt_;
   float mu_;
@@ -32,21 +26,27 @@ private:
     u_byte r, g, b, a;
   };
   float sumOriginal(Pixel* prev_img, u32 x, u32 y);
-  float sumCounter(Counter* counter, u32 x, u32 y);
-  void checkSingleSlot(Counter* counter, Pixel* prev_img, u32 x, u32 y);
-  void checkComputeResults();
-  void compileShaders();
-  void swap();
-
-  TimeCont update_timer_;
-  u32 loops_;
+  float sumCounter(f32* partial, u32 x, u32 local_y, u32 band_rows);
+  void checkSingleSlot(f32* partial, Pixel* prev_img, u32 x, u32 y, u32 band_start, u32 band_rows);
+  void checkComputeResults(u32 band_start, u32 band_rows);
+  void uploadUniforms(u32 program);
+  void resizeCounter();
+
+  void compileShaders() override;
+  void initResources() override;
+  void releaseResources() override;
+  size_t resourceBytes() override;
+  void step() override;
+  void imguiParams() override;
+  void saveParams(std::vector<f32> &params) override;
+  void loadParams(const std::vector<f32> &params) override;
 
   u32 counter_ssbo_;
+  s32 counter_radius_; // Radius the counter buffer is sized for
   u32 pre_compute_program_, compute_program_;
-
-  u32 width_, height_;
-
-  u32 prev_data_id_, current_data_id_;
+  LeniaTables tables_;
+  ShaderVariants pre_compute_variants_, compute_variants_; // Radius and weights folded in
+  boolean specialize_, specialized_;
 };
 
 #endif /* __LENIA_OP_H__ */
@@ -0,0 +1,36 @@
+#include "engine/engine.h"
+
+#ifndef __LENIA_TABLES_H__
+#define __LENIA_TABLES_H__ 1
+
+// Kernel weights and growth function of Lenia precomputed into SSBOs, so the
+// shaders (lenia_tables.glsl) only do multiply adds and a lerp per cell.
+// The weights are already divided by their total.
+class LeniaTables
+{
+public:
+  LeniaTables();
+  ~LeniaTables();
+
+  // Rebuilds and uploads only the tables whose parameters changed
+  void update(f32 radius, f32 rho, f32 omega, f32 mu, f32 sigma);
+  void bind();
+
+  // Parameters of the weights and the shader prefix that folds them in as
+  // RADIUS and the WEIGHTS array, for the ShaderVariants of the Lenia shaders
+  std::string variantKey();
+  std::string variantDefines();
+
+  // Frees the SSBOs, the next update() rebuilds everything
+  void release();
+  size_t bytes();
+
+private:
+  u32 weights_ssbo_, growth_ssbo_;
+  std::vector<f32> weights_, growth_;
+
+  f32 radius_, rho_, omega_;
+  f32 mu_, sigma_;
+};
+
+#endif /* __LENIA_TABLES_H__ */
@@ -0,0 +1,44 @@
+#include "engine/engine.h"
+
+#ifndef __SHADER_VARIANTS_H__
+#define __SHADER_VARIANTS_H__ 1
+
+// Compute programs specialized by a prefix of constants (#define RADIUS 15,
+// folded weights...) placed between `defines` and the shader source. A
+// variant is only requested once its parameters stayed the same for
+// VARIANT_SETTLE_UPDATES updates, then compiled without waiting
+// (GPUHelper::StartComputeProgram) while the caller keeps its generic program.
+class ShaderVariants
+{
+public:
+  ShaderVariants();
+  ~ShaderVariants();
+
+  // Shader source without the defines prefix
+  void init(const std::string &source, const char *name);
+
+  // Ready program for the parameter set, 0 while it settles or compiles.
+  // prefix is only called when the variant is first built.
+  u32 get(const std::string &key, const std::function<std::string()> &prefix);
+
+  void release();
+
+private:
+  struct Variant
+  {
+    u32 program;
+    std::string cache_path;
+    boolean ready;
+  };
+
+  std::string source_;
+  const char *name_;
+
+  std::unordered_map<std::string, Variant> variants_;
+  std::vector<std::string> order_; // Oldest first, evicted past MAX_SHADER_VARIANTS
+
+  std::string last_key_;
+  u32 settled_;
+};
+
+#endif /* __SHADER_VARIANTS_H__ */
@@ -0,0 +1,73 @@
+#include "engine/engine.h"
+#include "defines.h"
+
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__ 1
+
+// Snapshot file, little endian:
+//   Header
+//   params f32 values, the tunables of the automaton
+//   data_size bytes of cells, compressed unless SNAPSHOT_RAW
+// The cells are in row order, 1 bit each (SNAPSHOT_BITS, lowest bit first)
+// for the binary automata or the 8 bit alpha (SNAPSHOT_BYTES). A raw file
+// is uploaded straight from the mapping, the GPU expands the cells.
+class Snapshot
+{
+public:
+  struct Header
+  {
+    byte magic[4]; // SNAPSHOT_MAGIC
+    u32 version;   // SNAPSHOT_VERSION
+    byte name[32]; // Automaton::name(), not terminated when it fills the field
+    u32 width, height;
+    u64 generation;
+    u32 seed;
+    u32 encoding;    // SNAPSHOT_BITS or SNAPSHOT_BYTES
+    u32 compression; // SNAPSHOT_RAW, SNAPSHOT_RLE or SNAPSHOT_DELTA_RLE
+    u32 params;
+    u64 data_size;
+    u64 cells_size; // data_size once decompressed
+  };
+
+  // Cells of an RGBA readback, the state is the alpha. Pack then Compress
+  static void Encode(const u_byte *rgba, size_t cells, u32 encoding, u32 compression, std::vector<u_byte> &data);
+  static void Pack(const u_byte *rgba, size_t cells, u32 encoding, std::vector<u_byte> &packed);
+
+  // packed is left as scratch, data is packed itself when SNAPSHOT_RAW
+  static void Compress(std::vector<u_byte> &packed, u32 compression, std::vector<u_byte> &data);
+  static boolean Decompress(const u_byte *data, size_t size, u32 compression, size_t cells_size, std::vector<u_byte> &cells);
+
+  // Written next to path and renamed, a crash never leaves half a file
+  static boolean Write(const std::string &path, const Header &header, const std::vector<f32> &params, const std::vector<u_byte> &data);
+
+  // Checks the header and the sizes against the file, params and data
+  // point inside it
+  static boolean Parse(const u_byte *file, size_t size, Header &header, const u_byte *&params, const u_byte *&data);
+
+private:
+  Snapshot();
+  ~Snapshot();
+};
+
+// Read only mapping of a whole file
+class MappedFile
+{
+public:
+  MappedFile();
+  ~MappedFile();
+
+  boolean open(const std::string &path);
+  void close();
+
+  const u_byte *data();
+  size_t size();
+
+private:
+  const u_byte *data_;
+  size_t size_;
+#ifdef _WIN32
+  void *file_, *mapping_;
+#endif
+};
+
+#endif /* __SNAPSHOT_H__ */
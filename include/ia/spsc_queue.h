@@ -0,0 +1,55 @@
+#include "engine/engine.h"
+#include <atomic>
+
+#ifndef __SPSC_QUEUE_H__
+#define __SPSC_QUEUE_H__ 1
+
+// Bounded lock-free queue between one producer thread and one consumer
+// thread, holds up to N - 1 values. Each index is only written by its side.
+template <typename T, size_t N>
+class SPSCQueue
+{
+public:
+  SPSCQueue() : head_(0), tail_(0) {}
+
+  // Producer, false when full
+  boolean push(const T &value)
+  {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t next = (tail + 1) % N;
+    if (next == head_.load(std::memory_order_acquire))
+      return false;
+
+    items_[tail] = value;
+    tail_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer, false when empty
+  boolean pop(T &value)
+  {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+      return false;
+
+    value = items_[head];
+    head_.store((head + 1) % N, std::memory_order_release);
+    return true;
+  }
+
+  // Only exact while neither side is running
+  size_t size()
+  {
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return (tail + N - head) % N;
+  }
+
+private:
+  // Apart so the two sides do not share a cache line
+  alignas(64) std::atomic<size_t> head_;
+  alignas(64) std::atomic<size_t> tail_;
+  T items_[N];
+};
+
+#endif /* __SPSC_QUEUE_H__ */
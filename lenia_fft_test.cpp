@@ -0,0 +1,97 @@
+#include "ia/lenia_fft.h"
+#include "ia/defines.h"
+
+// Checks one LeniaFFT generation against the direct convolution of
+// lenia_cs.glsl, on sizes that need the radix 2, 3, 4, 5 and generic passes
+
+void RandomImage(std::vector<u_byte> &image)
+{
+  for (size_t i = 0; i < image.size(); i += 4)
+  {
+    image[i + 0] = 255;
+    image[i + 1] = 255;
+    image[i + 2] = 255;
+    image[i + 3] = static_cast<u_byte>(rand() % 255);
+  }
+}
+
+void OriginalLenia(const std::vector<u_byte> &prev_image, std::vector<f32> &image, s32 width, s32 height,
+                   f32 radius, f32 dt, f32 mu, f32 sigma, f32 rho, f32 omega)
+{
+  s32 r = static_cast<s32>(radius);
+
+  for (s32 y = 0; y < height; y++)
+  {
+    for (s32 x = 0; x < width; x++)
+    {
+      f32 sum = 0.0f;
+      f32 total = 0.0f;
+      for (s32 j = -r; j <= r; j++)
+      {
+        for (s32 i = -r; i <= r; i++)
+        {
+          s32 nx = (((x + i) % width) + width) % width;
+          s32 ny = (((y + j) % height) + height) % height;
+          f32 alpha = static_cast<f32>(prev_image[(ARRAY_2D_INDEX(nx, ny, width)) * 4 + 3]) / 255.0f;
+
+          f32 fi = static_cast<f32>(i);
+          f32 fj = static_cast<f32>(j);
+          f32 norm_rad = EuclidianDistance(fi, fj) / radius;
+          f32 weight = GaussBell(norm_rad, rho, omega);
+
+          sum += alpha * weight;
+          total += weight;
+        }
+      }
+
+      f32 avg = sum / total;
+      f32 growth = (GaussBell(avg, mu, sigma) * 2.0f) - 1.0f;
+      f32 value = static_cast<f32>(prev_image[(ARRAY_2D_INDEX(x, y, width)) * 4 + 3]) / 255.0f;
+
+      image[ARRAY_2D_INDEX(x, y, width)] = std::clamp(value + (1.0f / dt) * growth, 0.0f, 1.0f);
+    }
+  }
+}
+
+void Check(s32 width, s32 height, f32 radius)
+{
+  // mu at the mean of the random image, so the growth depends on the convolution
+  f32 dt = 5.0f, mu = 0.5f, sigma = 0.014f, rho = 0.5f, omega = 0.15f;
+
+  std::vector<u_byte> original(static_cast<size_t>(width * height * 4));
+  std::vector<u_byte> fft_image(original.size());
+  std::vector<f32> next(static_cast<size_t>(width * height));
+  RandomImage(original);
+
+  OriginalLenia(original, next, width, height, radius, dt, mu, sigma, rho, omega);
+
+  LeniaFFT lenia;
+  lenia.init(static_cast<u32>(width), static_cast<u32>(height));
+  lenia.load(original.data());
+  lenia.setKernel(radius, rho, omega);
+  lenia.step(dt, mu, sigma);
+  lenia.store(fft_image.data());
+
+  for (size_t i = 0; i < next.size(); i++)
+  {
+    s32 expected = static_cast<s32>(next[i] * 255.0f + 0.5f);
+    boolean check = std::abs(expected - static_cast<s32>(fft_image[i * 4 + 3])) <= 1;
+    if (!check)
+      fprintf(stderr, "Failed %dx%d radius %.1f in %zu: %d != %d\n", width, height, radius, i, expected,
+              fft_image[i * 4 + 3]);
+    assert(check);
+  }
+}
+
+int main(int, char **)
+{
+  srand(static_cast<u32>(time(NULL)));
+
+  Check(64, 64, 15.0f);
+  Check(120, 90, 15.0f);
+  Check(75, 37, 10.0f);
+  Check(32, 20, 12.0f);
+
+  fprintf(stdout, "All correct\n");
+  return 0;
+}
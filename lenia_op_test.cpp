@@ -3,6 +3,7 @@
 #include <cmath>
 
 #define MAX_RADIUS 20
+#define LENIA_OP_BAND 128
 
 #define C_WIDTH 512
 #define C_HEIGHT 512
@@ -55,7 +56,8 @@ float u_omega = 0.15f;
 Vec4 prev_image[C_WIDTH * C_HEIGHT];
 Vec4 original_image[C_WIDTH * C_HEIGHT];
 Vec4 divided_image[C_WIDTH * C_HEIGHT];
-Counter data[C_WIDTH * C_HEIGHT * MAX_RADIUS];
+float data[C_WIDTH * (LENIA_OP_BAND + 2 * MAX_RADIUS) * (MAX_RADIUS + 1)];
+float u_total = 0.0f;
 
 float clamp(float value, float min_value, float max_value)
 {
@@ -130,27 +132,32 @@ void OriginalLenia()
   }
 }
 
-void Step1()
+void Normalization()
 {
-  for (unsigned z = 0; z < u_radius; z++)
+  u_total = 0.0f;
+  for (int y = -u_radius; y <= u_radius; y++)
+    for (int x = -u_radius; x <= u_radius; x++)
+      u_total += GaussBell(EuclidianDistance(x, y) / u_radius, u_rho, u_omega);
+}
+
+void Step1(int band_start, int band_rows)
+{
+  for (unsigned z = 0; z <= u_radius; z++)
   {
-    for (unsigned y = 0; y < C_HEIGHT; y++)
+    for (unsigned y = 0; y < band_rows; y++)
     {
       for (unsigned x = 0; x < C_WIDTH; x++)
       {
         Vec3 gid = Vec3{(float)(x), (float)(y), (float)(z)};
 
-        int local_y = (gid.z - u_radius);
-        int neighbour_y = (local_y + gid.y);
+        int local_y = gid.z;
+        int neighbour_y = (band_start - u_radius + gid.y);
         if (neighbour_y < 0)
           neighbour_y = (C_HEIGHT + neighbour_y);
         if (neighbour_y >= C_HEIGHT)
           neighbour_y -= C_HEIGHT;
 
-        int total_columns = TOTAL_COLUMNS(u_radius);
-
         float sum = 0.0;
-        float total = 0.0;
         for (int local_x = -u_radius; local_x <= u_radius; local_x++)
         {
           int neighbour_x = (local_x + gid.x);
@@ -164,45 +171,38 @@ void Step1()
           float alpha = prev_image[neighbor_index].a;
 
           float norm_rad = EuclidianDistance(local_x, local_y) / u_radius;
-          float weight = GaussBell(norm_rad, u_rho, u_omega);
+          float weight = GaussBell(norm_rad, u_rho, u_omega) / u_total;
 
           sum += (alpha * weight);
-          total += weight;
         }
 
-        int index = ARRAY_3D_INDEX(gid.x, gid.y, gid.z, C_HEIGHT, MAX_RADIUS);
-        data[index] = Counter{sum, total};
+        data[(z * band_rows + y) * C_WIDTH + x] = sum;
       }
     }
   }
 }
 
-Vec2 DividedConvolution(Vec2 coords)
+float DividedConvolution(Vec2 coords, int band_rows)
 {
   float sum = 0;
-  float total = 0;
-  int total_lines = TOTAL_LINES(u_radius);
-  for (unsigned i = 0; i < total_lines; i++)
+  for (int local_y = -u_radius; local_y <= u_radius; local_y++)
   {
-    int index = ARRAY_3D_INDEX(coords.x, coords.y, i, C_HEIGHT, MAX_RADIUS);
-    sum += data[index].live_;
-    total += data[index].count_;
+    int row = coords.y + u_radius + local_y;
+    sum += data[(abs(local_y) * band_rows + row) * C_WIDTH + (int)(coords.x)];
   }
-  return Vec2{sum, total};
+  return sum;
 }
 
-void Step2()
+void Step2(int band_start, int rows, int band_rows)
 {
-  for (unsigned y = 0; y < C_HEIGHT; y++)
+  for (unsigned y = 0; y < rows; y++)
   {
-    for (unsigned x = 0; x < C_HEIGHT; x++)
+    for (unsigned x = 0; x < C_WIDTH; x++)
     {
       // Obtener el color previo
-      int current_index = ARRAY_2D_INDEX(x, y, C_WIDTH);
-
-      Vec2 conv = DividedConvolution(Vec2{(float)(x), (float)(y)});
+      int current_index = ARRAY_2D_INDEX(x, band_start + y, C_WIDTH);
 
-      float avg = conv.x / conv.y;
+      float avg = DividedConvolution(Vec2{(float)(x), (float)(y)}, band_rows);
 
       float growth = (GaussBell(avg, u_mu, u_sigma) * 2.0f) - 1.0f;
 
@@ -217,8 +217,16 @@ void Step2()
 
 void DividedLenia()
 {
-  Step1();
-  Step2();
+  Normalization();
+
+  for (int band_start = 0; band_start < C_HEIGHT; band_start += LENIA_OP_BAND)
+  {
+    int rows = (C_HEIGHT - band_start < LENIA_OP_BAND) ? C_HEIGHT - band_start : LENIA_OP_BAND;
+    int band_rows = rows + TOTAL_LINES(u_radius) - 1;
+
+    Step1(band_start, band_rows);
+    Step2(band_start, rows, band_rows);
+  }
 }
 
 int main(int, char **)
@@ -0,0 +1,136 @@
+#include "ia/snapshot.h"
+#include "ia/defines.h"
+
+// Round trips the snapshot payloads through every encoding and compression,
+// then a whole file through Write, MappedFile and Parse
+
+struct Pixel
+{
+  u_byte r, g, b, a;
+};
+
+void RandomImage(std::vector<Pixel> &image, boolean binary)
+{
+  for (Pixel &pixel : image)
+    pixel = Pixel{255, 255, 255, static_cast<u_byte>(binary ? ((rand() % 5 < 2) ? 255 : 0) : rand() % 255)};
+}
+
+// Runs and ramps, what RLE and delta are for
+void SmoothImage(std::vector<Pixel> &image, boolean binary)
+{
+  for (size_t i = 0; i < image.size(); i++)
+  {
+    u_byte value = static_cast<u_byte>((i / 300) % 2 ? (i / 7) % 256 : 0);
+    image[i] = Pixel{255, 255, 255, binary ? static_cast<u_byte>(value > 127 ? 255 : 0) : value};
+  }
+}
+
+u_byte Cell(const std::vector<u_byte> &cells, size_t i, u32 encoding)
+{
+  if (encoding == SNAPSHOT_BITS)
+    return ((cells[i >> 3] >> (i & 7)) & 1) ? 255 : 0;
+
+  return cells[i];
+}
+
+void Check(const std::vector<Pixel> &image, u32 encoding, u32 compression)
+{
+  size_t cells_size = (encoding == SNAPSHOT_BITS) ? (image.size() + 7) / 8 : image.size();
+
+  std::vector<u_byte> data;
+  Snapshot::Encode(reinterpret_cast<const u_byte *>(image.data()), image.size(), encoding, compression, data);
+
+  std::vector<u_byte> cells = data;
+  if (compression != SNAPSHOT_RAW)
+  {
+    boolean decoded = Snapshot::Decompress(data.data(), data.size(), compression, cells_size, cells);
+    if (!decoded)
+      fprintf(stderr, "Failed to decompress %zu cells, encoding %u, compression %u\n", image.size(), encoding, compression);
+    assert(decoded);
+  }
+
+  assert(cells.size() == cells_size);
+  for (size_t i = 0; i < image.size(); i++)
+  {
+    u_byte expected = (encoding == SNAPSHOT_BITS) ? (image[i].a > 127 ? 255 : 0) : image[i].a;
+    boolean check = Cell(cells, i, encoding) == expected;
+    if (!check)
+      fprintf(stderr, "Failed %zu cells, encoding %u, compression %u in %zu\n", image.size(), encoding, compression, i);
+    assert(check);
+  }
+}
+
+void CheckAll(size_t count)
+{
+  std::vector<Pixel> image(count);
+  for (u32 encoding = SNAPSHOT_BITS; encoding <= SNAPSHOT_BYTES; encoding++)
+  {
+    for (u32 compression = SNAPSHOT_RAW; compression <= SNAPSHOT_DELTA_RLE; compression++)
+    {
+      RandomImage(image, encoding == SNAPSHOT_BITS);
+      Check(image, encoding, compression);
+      SmoothImage(image, encoding == SNAPSHOT_BITS);
+      Check(image, encoding, compression);
+    }
+  }
+}
+
+void CheckFile()
+{
+  const u32 width = 100, height = 37;
+  std::vector<Pixel> image(width * height);
+  SmoothImage(image, false);
+
+  Snapshot::Header header = {};
+  std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = SNAPSHOT_VERSION;
+  std::strncpy(header.name, "Lenia", sizeof(header.name));
+  header.width = width;
+  header.height = height;
+  header.generation = 123456789;
+  header.seed = 42;
+  header.encoding = SNAPSHOT_BYTES;
+  header.compression = SNAPSHOT_DELTA_RLE;
+
+  std::vector<f32> params = {15.0f, 5.0f, 0.14f};
+  header.params = static_cast<u32>(params.size());
+
+  std::vector<u_byte> data;
+  Snapshot::Encode(reinterpret_cast<const u_byte *>(image.data()), image.size(), header.encoding, header.compression, data);
+  header.data_size = data.size();
+  header.cells_size = image.size();
+
+  std::string path = "snapshot_test.snap";
+  assert(Snapshot::Write(path, header, params, data));
+
+  MappedFile file;
+  assert(file.open(path));
+
+  Snapshot::Header read;
+  const u_byte *read_params = nullptr;
+  const u_byte *read_data = nullptr;
+  assert(Snapshot::Parse(file.data(), file.size(), read, read_params, read_data));
+  assert(read.generation == header.generation && read.seed == header.seed && read.width == width && read.height == height);
+  assert(!std::memcmp(read_params, params.data(), params.size() * sizeof(f32)));
+  assert(!std::memcmp(read_data, data.data(), data.size()));
+
+  // A truncated file is rejected
+  assert(!Snapshot::Parse(file.data(), file.size() - 1, read, read_params, read_data));
+
+  file.close();
+  std::remove(path.c_str());
+}
+
+int main(int, char **)
+{
+  srand(static_cast<u32>(time(NULL)));
+
+  CheckAll(1024 * 64);
+  CheckAll(100 * 37);
+  CheckAll(129);
+  CheckAll(1);
+  CheckFile();
+
+  fprintf(stdout, "All correct\n");
+  return 0;
+}
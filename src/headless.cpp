@@ -0,0 +1,349 @@
+#include "engine/engine.h"
+#include "ia/ia.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+// Offscreen runner, steps one automaton without window using an EGL
+// surfaceless context (works with Mesa llvmpipe)
+//
+// Usage: ia_headless [-m mode] [-g steps] [-q] [-s size] [-b backend] [-k log2] [-t steps] [-r radius] [-f generations] [-e seed] [-c] [-o dir] [-x format] [-l file] [-w file] [-p generations]
+//   -m  Automaton index or name (default 0)
+//   -g  Updates to run (default 1000), one generation each unless batched
+//   -q  Only print the summary
+//   -s  Grid size as WIDTHxHEIGHT (default 1024x1024)
+//   -b  Conway backend: texture, tiled, packed, cpu or hashlife
+//       Lenia backend: texture, cpufft or gpufft
+//   -k  Hashlife generations per update as 2^k
+//   -t  Tiled generations per dispatch
+//   -r  Lenia radius
+//   -f  Generations batched per update (default 1)
+//   -e  Seed of the initial state (default 0)
+//   -c  Capture the grid after every update through the PBO ring
+//   -o  Write the captured updates as an image sequence to dir, implies -c
+//   -x  Image sequence format: png (default) or raw
+//   -l  Start from a snapshot of the same automaton, its size and parameters
+//   -w  Write a snapshot after the last update
+//   -p  Checkpoint to checkpoints/ every that many generations, in the background
+
+static EGLDisplay display = EGL_NO_DISPLAY;
+static EGLContext context = EGL_NO_CONTEXT;
+
+static boolean CreateContext()
+{
+  // Display
+  /////////////////////////////////////////////////////////////////////////////
+  auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  if (get_platform_display)
+    display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+  if (display == EGL_NO_DISPLAY)
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+  EGLint major, minor;
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+  {
+    fprintf(stderr, "Error initializing EGL: 0x%x\n", eglGetError());
+    return false;
+  }
+  /////////////////////////////////////////////////////////////////////////////
+
+  // Context
+  /////////////////////////////////////////////////////////////////////////////
+  eglBindAPI(EGL_OPENGL_API);
+
+  const EGLint config_attribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+  EGLConfig config = nullptr;
+  EGLint num_configs = 0;
+  eglChooseConfig(display, config_attribs, &config, 1, &num_configs);
+
+  const EGLint context_attribs[] = {
+      EGL_CONTEXT_MAJOR_VERSION, 4,
+      EGL_CONTEXT_MINOR_VERSION, 3,
+      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+      EGL_NONE};
+
+  // Surfaceless displays usually expose no configs, EGL_KHR_no_config_context
+  context = eglCreateContext(display, num_configs > 0 ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, context_attribs);
+  if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+  {
+    fprintf(stderr, "Error creating GL 4.3 context: 0x%x\n", eglGetError());
+    return false;
+  }
+  /////////////////////////////////////////////////////////////////////////////
+
+  // GLEW reports the missing GLX display but the GL entry points are loaded
+  glewExperimental = GL_TRUE;
+  GLenum glew_error = glewInit();
+  if (glew_error != GLEW_OK && glew_error != GLEW_ERROR_NO_GLX_DISPLAY)
+  {
+    fprintf(stderr, "Error initializing GLEW: %s\n", glewGetErrorString(glew_error));
+    return false;
+  }
+  glGetError();
+
+  fprintf(stdout, "EGL %d.%d - %s - %s\n", major, minor, glGetString(GL_VERSION), glGetString(GL_RENDERER));
+  return true;
+}
+
+static void DestroyContext()
+{
+  if (display == EGL_NO_DISPLAY)
+    return;
+
+  eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (context != EGL_NO_CONTEXT)
+    eglDestroyContext(display, context);
+  eglTerminate(display);
+}
+
+s32 main(s32 argc, byte *argv[])
+{
+  const byte *mode = "0";
+  u32 steps = 1000;
+  boolean quiet = false;
+  const byte *backend = "texture";
+  u32 step_log2 = 0;
+  s32 temporal_steps = 4;
+  f32 radius = 0.0f;
+  u32 batch = 1;
+  u32 seed = 0;
+  boolean capture = false;
+  const byte *output = nullptr;
+  const byte *format = "png";
+  const byte *load = nullptr;
+  const byte *save = nullptr;
+  u64 checkpoint = 0;
+  u32 width = C_WIDTH;
+  u32 height = C_HEIGHT;
+
+  for (s32 i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-m") && i + 1 < argc)
+      mode = argv[++i];
+    else if (!strcmp(argv[i], "-g") && i + 1 < argc)
+      steps = static_cast<u32>(std::strtoul(argv[++i], nullptr, 10));
+    else if (!strcmp(argv[i], "-q"))
+      quiet = true;
+    else if (!strcmp(argv[i], "-s") && i + 1 < argc && sscanf(argv[i + 1], "%ux%u", &width, &height) == 2)
+      i++;
+    else if (!strcmp(argv[i], "-b") && i + 1 < argc)
+      backend = argv[++i];
+    else if (!strcmp(argv[i], "-k") && i + 1 < argc)
+      step_log2 = static_cast<u32>(std::strtoul(argv[++i], nullptr, 10));
+    else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+      temporal_steps = std::atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+      radius = std::strtof(argv[++i], nullptr);
+    else if (!strcmp(argv[i], "-f") && i + 1 < argc)
+      batch = static_cast<u32>(std::strtoul(argv[++i], nullptr, 10));
+    else if (!strcmp(argv[i], "-e") && i + 1 < argc)
+      seed = static_cast<u32>(std::strtoul(argv[++i], nullptr, 10));
+    else if (!strcmp(argv[i], "-c"))
+      capture = true;
+    else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+      output = argv[++i];
+    else if (!strcmp(argv[i], "-x") && i + 1 < argc)
+      format = argv[++i];
+    else if (!strcmp(argv[i], "-l") && i + 1 < argc)
+      load = argv[++i];
+    else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+      save = argv[++i];
+    else if (!strcmp(argv[i], "-p") && i + 1 < argc)
+      checkpoint = std::strtoull(argv[++i], nullptr, 10);
+    else
+    {
+      fprintf(stderr, "Usage: %s [-m mode] [-g steps] [-q] [-s size] [-b backend] [-k log2] [-t steps] [-r radius] [-f generations] [-e seed] [-c] [-o dir] [-x format] [-l file] [-w file] [-p generations]\n", argv[0]);
+      return -1;
+    }
+  }
+
+  if (!CreateContext())
+  {
+    DestroyContext();
+    return -1;
+  }
+
+  AutomataRegistry automata;
+  automata.add<Conway>();
+  automata.add<SmoothLife>();
+  automata.add<Lenia>();
+  automata.add<LeniaOp>();
+
+  Automaton *automaton = automata.find(mode);
+  if (!automaton)
+    automaton = automata.get(static_cast<u32>(std::strtoul(mode, nullptr, 10)));
+  if (!automaton)
+  {
+    fprintf(stderr, "Unknown mode: %s\n", mode);
+    DestroyContext();
+    return -1;
+  }
+
+  // Same seed and size give the same run
+  automaton->setSeed(seed);
+  automaton->init(Math::Vec2(static_cast<f32>(width), static_cast<f32>(height)));
+  automaton->setGenerationsPerFrame(batch);
+
+  if (Conway *conway = dynamic_cast<Conway *>(automaton))
+  {
+    if (!strcmp(backend, "tiled"))
+      conway->setBackend(Conway::Backend::Tiled);
+    if (!strcmp(backend, "packed"))
+      conway->setBackend(Conway::Backend::Packed);
+    if (!strcmp(backend, "cpu"))
+      conway->setBackend(Conway::Backend::CPU);
+    if (!strcmp(backend, "hashlife"))
+      conway->setBackend(Conway::Backend::Hashlife);
+    conway->setStepLog2(step_log2);
+    conway->setTemporalSteps(temporal_steps);
+  }
+
+  if (Lenia *lenia = dynamic_cast<Lenia *>(automaton))
+  {
+    if (!strcmp(backend, "cpufft"))
+      lenia->setBackend(Lenia::Backend::CPUFFT);
+    if (!strcmp(backend, "gpufft"))
+      lenia->setBackend(Lenia::Backend::GPUFFT);
+    if (radius > 0.0f)
+      lenia->radius_ = radius;
+  }
+
+  if (load && !automaton->load(load))
+  {
+    DestroyContext();
+    return -1;
+  }
+
+  // Nothing reloads the sources here, update() would never step
+  if (automaton->failed())
+  {
+    fprintf(stderr, "%s programs failed to build\n", automaton->name());
+    DestroyContext();
+    return -1;
+  }
+
+  automaton->setCheckpoints(CHECKPOINT_DIR, checkpoint);
+
+  fprintf(stdout, "%s %ux%u, %u updates\n", automaton->name(), automaton->width(), automaton->height(), steps);
+
+  // Run
+  /////////////////////////////////////////////////////////////////////////////
+  // update() no longer waits for the GPU, the wall time of the whole run
+  // includes a single glFinish at the end and the per update GPU times come
+  // from the timer queries, a few updates late
+  size_t gpu_total = 0;
+  size_t min = SIZE_MAX;
+  size_t max = 0;
+  u32 timed = 0;
+  u64 start = automaton->generation(); // Restored by -l
+
+  if (!quiet)
+    fprintf(stdout, "generation,update_mcs,gpu_mcs\n");
+
+  // Consumed on this thread, the frames are counted and, with -o, encoded
+  // on the TaskManager workers
+  FrameCapture frame_capture;
+  FrameExporter exporter;
+
+  if (output)
+  {
+    capture = true;
+    FrameExporter::Format export_format = strcmp(format, "raw") ? FrameExporter::Format::PNG : FrameExporter::Format::Raw;
+    if (!exporter.start(&frame_capture, output, export_format))
+    {
+      DestroyContext();
+      return -1;
+    }
+  }
+
+  auto drain = [&]()
+  {
+    while (CapturedFrame *frame = frame_capture.pop())
+      frame_capture.recycle(frame);
+  };
+
+  TimeCont run_timer;
+  run_timer.startTime();
+
+  for (u32 i = 0; i < steps;)
+  {
+    // Every update is written, the simulation waits for the encoders
+    if (exporter.running())
+    {
+      frame_capture.poll();
+      exporter.pump();
+      if (exporter.saturated())
+        continue;
+    }
+
+    // Busy while SIM_FRAMES_IN_FLIGHT batches are queued
+    if (!automaton->update())
+      continue;
+    i++;
+
+    if (capture)
+    {
+      frame_capture.capture(automaton->currentTexture(), automaton->width(), automaton->height(), automaton->generation());
+      if (exporter.running())
+        exporter.pump();
+      else
+        drain();
+    }
+
+    size_t gpu = automaton->gpuTime();
+    if (gpu > 0)
+    {
+      gpu_total += gpu;
+      min = std::min(min, gpu);
+      max = std::max(max, gpu);
+      timed++;
+    }
+
+    if (!quiet)
+      fprintf(stdout, "%llu,%zu,%zu\n", static_cast<unsigned long long>(automaton->generation()), automaton->updateTime(), gpu);
+  }
+
+  glFinish();
+  run_timer.stopTime();
+  size_t total = run_timer.getElapsedTime(TimeCont::Precision::microseconds);
+
+  if (capture)
+  {
+    frame_capture.poll();
+    if (exporter.running())
+      exporter.stop();
+    else
+      drain();
+    frame_capture.release();
+  }
+  /////////////////////////////////////////////////////////////////////////////
+
+  if (save && !automaton->save(save))
+  {
+    DestroyContext();
+    return -1;
+  }
+
+  if (steps > 0 && total > 0)
+  {
+    f64 generations = static_cast<f64>(automaton->generation() - start);
+    f64 cells = static_cast<f64>(automaton->width()) * static_cast<f64>(automaton->height());
+    fprintf(stdout, "Total: %zu mcs, mean: %.1f mcs per update\n", total, static_cast<f64>(total) / static_cast<f64>(steps));
+    if (timed > 0)
+      fprintf(stdout, "GPU mean: %.1f mcs, min: %zu mcs, max: %zu mcs\n", static_cast<f64>(gpu_total) / static_cast<f64>(timed), min, max);
+    fprintf(stdout, "Throughput: %.1f generations/s, %.3f Gcells/s\n",
+            generations * 1.0e6 / static_cast<f64>(total), cells * generations / static_cast<f64>(total) / 1.0e3);
+  }
+
+  if (capture)
+  {
+    f64 frame_mb = static_cast<f64>(automaton->width()) * static_cast<f64>(automaton->height()) * 4.0 / (1 << 20);
+    fprintf(stdout, "Captured: %llu frames (%.1f MB), dropped: %llu\n", static_cast<unsigned long long>(frame_capture.captured()),
+            static_cast<f64>(frame_capture.captured()) * frame_mb, static_cast<unsigned long long>(frame_capture.dropped()));
+  }
+  if (output)
+    fprintf(stdout, "Written: %llu frames to %s, failed: %llu\n", static_cast<unsigned long long>(exporter.written()), output,
+            static_cast<unsigned long long>(exporter.failed()));
+
+  DestroyContext();
+  return 0;
+}
@@ -0,0 +1,206 @@
+#include "ia/automata_registry.h"
+#include "ia/defines.h"
+
+AutomataRegistry::AutomataRegistry()
+    : clock_(0), budget_(static_cast<size_t>(VRAM_BUDGET_MB) << 20), budget_mb_(VRAM_BUDGET_MB),
+      mode_(0), width_(0), height_(0), grid_input_{0, 0} {}
+
+AutomataRegistry::~AutomataRegistry() {}
+
+void AutomataRegistry::init(Math::Vec2 win)
+{
+  width_ = static_cast<u32>(win.x);
+  height_ = static_cast<u32>(win.y);
+
+  activate();
+
+  grid_input_[0] = static_cast<s32>(width_);
+  grid_input_[1] = static_cast<s32>(height_);
+}
+
+// Brings the active automaton to the registry grid, allocating it on the
+// first use
+void AutomataRegistry::activate()
+{
+  Automaton *automaton = active();
+  if (!automaton)
+    return;
+
+  if (automaton->resident())
+    automaton->resize(width_, height_);
+  else
+    automaton->init(Math::Vec2(static_cast<f32>(width_), static_cast<f32>(height_)));
+
+  // Sizes out of range fall back to the default grid
+  width_ = automaton->width();
+  height_ = automaton->height();
+
+  last_used_[static_cast<size_t>(mode_)] = ++clock_;
+  trim();
+}
+
+void AutomataRegistry::trim()
+{
+  size_t used = gpuBytes();
+
+  while (used > budget_)
+  {
+    s32 oldest = -1;
+    for (s32 i = 0; i < static_cast<s32>(automata_.size()); i++)
+    {
+      if (i == mode_ || !automata_[i]->resident())
+        continue;
+
+      if (oldest < 0 || last_used_[i] < last_used_[oldest])
+        oldest = i;
+    }
+
+    // Only the active one left
+    if (oldest < 0)
+      break;
+
+    used -= automata_[oldest]->gpuBytes();
+    automata_[oldest]->release();
+  }
+}
+
+void AutomataRegistry::update()
+{
+  if (Automaton *automaton = active())
+    automaton->update();
+}
+
+void AutomataRegistry::imgui()
+{
+  Automaton *automaton = active();
+  if (!automaton)
+    return;
+
+  automaton->imgui();
+
+  // Same window, appended after the automaton parameters
+  ImGui::Begin("GPU Automata");
+
+  ImGui::InputInt2("Grid size", grid_input_);
+  if (ImGui::Button("Resize"))
+  {
+    if (grid_input_[0] <= 0 || grid_input_[1] <= 0 ||
+        !resize(static_cast<u32>(grid_input_[0]), static_cast<u32>(grid_input_[1])))
+    {
+      grid_input_[0] = static_cast<s32>(width_);
+      grid_input_[1] = static_cast<s32>(height_);
+    }
+  }
+
+  // Memory
+  /////////////////////////////////////////////////////////////////////////////
+  ImGui::Separator();
+
+  if (ImGui::SliderInt("Memory budget (MB)", &budget_mb_, 0, 4096))
+    setBudget(static_cast<size_t>(budget_mb_) << 20);
+
+  for (auto &entry : automata_)
+  {
+    if (entry->resident())
+      ImGui::Text("%s: %.1f MB", entry->name(), static_cast<f64>(entry->gpuBytes()) / (1 << 20));
+    else
+      ImGui::Text("%s: released", entry->name());
+  }
+
+  ImGui::Text("Total: %.1f MB", static_cast<f64>(gpuBytes()) / (1 << 20));
+  /////////////////////////////////////////////////////////////////////////////
+
+  ImGui::End();
+}
+
+void AutomataRegistry::reset()
+{
+  // Seeding is deterministic, the next seed gives a new state
+  if (Automaton *automaton = active())
+  {
+    automaton->setSeed(automaton->seed() + 1);
+    automaton->reset();
+  }
+}
+
+void AutomataRegistry::reload()
+{
+  for (auto &automaton : automata_)
+    automaton->reload();
+}
+
+boolean AutomataRegistry::resize(u32 width, u32 height)
+{
+  Automaton *automaton = active();
+  if (!automaton || !automaton->resize(width, height))
+    return false;
+
+  width_ = width;
+  height_ = height;
+
+  return true;
+}
+
+void AutomataRegistry::setBudget(size_t bytes)
+{
+  budget_ = bytes;
+  trim();
+}
+
+size_t AutomataRegistry::budget() { return budget_; }
+
+size_t AutomataRegistry::gpuBytes()
+{
+  size_t total = 0;
+  for (auto &automaton : automata_)
+    total += automaton->gpuBytes();
+
+  return total;
+}
+
+void AutomataRegistry::select(s32 mode)
+{
+  s32 max = static_cast<s32>(automata_.size()) - 1;
+
+  if (mode > max)
+    mode = 0;
+  if (mode < 0)
+    mode = max;
+
+  mode_ = mode;
+
+  Automaton *automaton = active();
+  if (!automaton)
+    return;
+
+  activate();
+
+  fprintf(stdout, "Mode: %d - %s\n", mode_, automaton->name());
+}
+
+void AutomataRegistry::next() { select(mode_ + 1); }
+
+void AutomataRegistry::prev() { select(mode_ - 1); }
+
+Automaton *AutomataRegistry::active() { return get(static_cast<u32>(mode_)); }
+
+Automaton *AutomataRegistry::get(u32 index)
+{
+  if (index >= automata_.size())
+    return nullptr;
+
+  return automata_[index].get();
+}
+
+Automaton *AutomataRegistry::find(const char *name)
+{
+  for (auto &automaton : automata_)
+    if (std::strcmp(automaton->name(), name) == 0)
+      return automaton.get();
+
+  return nullptr;
+}
+
+s32 AutomataRegistry::mode() { return mode_; }
+
+u32 AutomataRegistry::count() { return static_cast<u32>(automata_.size()); }
@@ -0,0 +1,637 @@
+#include "ia/automaton.h"
+#include "ia/gpu_helper.h"
+#include "ia/snapshot.h"
+#include "ia/defines.h"
+
+Automaton::Automaton(const char *name, Seed seed)
+    : loops_(0), width_(0), height_(0), prev_data_id_(0), current_data_id_(0), name_(name), seed_(seed), seed_value_(0), seed_program_(0), compiled_(false), stats_program_(0), stats_enabled_(false), stats_measured_(0), stats_missed_(0), restore_program_(0), store_program_(0), snapshot_compression_(SNAPSHOT_RLE), reloading_(false), failed_programs_(0),
+      generations_per_frame_(1), target_hz_(0.0f), pending_generations_(0.0), frame_timed_(false),
+      fences_{}, fence_index_(0) {}
+
+Automaton::~Automaton() {}
+
+boolean Automaton::validSize(u32 width, u32 height)
+{
+  s32 max_size = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+  if (width < MIN_GRID_SIZE || height < MIN_GRID_SIZE ||
+      width > static_cast<u32>(max_size) || height > static_cast<u32>(max_size))
+  {
+    fprintf(stderr, "%s grid %ux%u out of [%d, %d]\n", name_, width, height, MIN_GRID_SIZE, max_size);
+    return false;
+  }
+
+  return true;
+}
+
+void Automaton::init(Math::Vec2 win)
+{
+  if (resident())
+  {
+    resize(static_cast<u32>(win.x), static_cast<u32>(win.y));
+    return;
+  }
+
+  loops_ = 0;
+  width_ = static_cast<u32>(win.x);
+  height_ = static_cast<u32>(win.y);
+
+  if (!validSize(width_, height_))
+  {
+    width_ = C_WIDTH;
+    height_ = C_HEIGHT;
+  }
+
+  allocateTextures();
+
+  if (!compiled_)
+  {
+    compileCommon();
+    compileShaders();
+    compiled_ = true;
+  }
+
+  initResources();
+
+  reset();
+}
+
+void Automaton::release()
+{
+  if (!resident())
+    return;
+
+  clearFences();
+  releaseResources();
+  gpu_timer_.release();
+  stats_.release();
+  checkpoints_.release();
+
+  glDeleteTextures(1, &current_data_id_);
+  glDeleteTextures(1, &prev_data_id_);
+  current_data_id_ = 0;
+  prev_data_id_ = 0;
+}
+
+boolean Automaton::resident() { return current_data_id_ != 0; }
+
+boolean Automaton::failed() { return failed_programs_ > 0; }
+
+void Automaton::reload()
+{
+  if (!compiled_)
+    return;
+
+  // A reload still compiling is dropped for the newer sources
+  for (Reload &pending : reloads_)
+    glDeleteProgram(pending.next);
+  reloads_.clear();
+
+  reloading_ = true;
+  compileCommon();
+  compileShaders();
+  reloading_ = false;
+}
+
+void Automaton::buildProgram(u32 &program, const std::string &source, const char *name)
+{
+  if (!reloading_)
+  {
+    program = GPUHelper::CreateComputeProgram(source, name);
+    if (!program)
+      failed_programs_++;
+
+    return;
+  }
+
+  Reload pending = {&program, 0, std::string(), name};
+  pending.next = GPUHelper::StartComputeProgram(source, pending.cache_path);
+  reloads_.push_back(pending);
+}
+
+void Automaton::pollReload()
+{
+  if (reloads_.empty())
+    return;
+
+  for (Reload &pending : reloads_)
+    if (!GPUHelper::ComputeProgramDone(pending.next))
+      return;
+
+  // All or nothing, the passes of an automaton share their buffer layouts
+  boolean linked = true;
+  for (Reload &pending : reloads_)
+  {
+    pending.next = GPUHelper::FinishComputeProgram(pending.next, pending.cache_path, pending.name);
+    linked = linked && pending.next;
+  }
+
+  for (Reload &pending : reloads_)
+  {
+    if (!linked)
+    {
+      if (pending.next)
+        glDeleteProgram(pending.next);
+      continue;
+    }
+
+    if (*pending.program)
+      glDeleteProgram(*pending.program);
+    *pending.program = pending.next;
+  }
+
+  if (linked)
+    failed_programs_ = 0;
+
+  fprintf(stdout, linked ? "%s programs reloaded\n" : "%s reload failed, keeping the old programs\n", name_);
+  reloads_.clear();
+}
+
+boolean Automaton::resize(u32 width, u32 height)
+{
+  if (width == width_ && height == height_)
+    return true;
+
+  if (!validSize(width, height))
+    return false;
+
+  width_ = width;
+  height_ = height;
+
+  // Allocated at that size by the next init()
+  if (!resident())
+    return true;
+
+  // Immutable storage, the textures are recreated at the new size
+  glDeleteTextures(1, &current_data_id_);
+  glDeleteTextures(1, &prev_data_id_);
+  current_data_id_ = 0;
+  prev_data_id_ = 0;
+  allocateTextures();
+
+  releaseResources();
+  initResources();
+  reset();
+
+  return true;
+}
+
+void Automaton::allocateTextures()
+{
+  if (!current_data_id_)
+    current_data_id_ = GPUHelper::CreateTexture(width_, height_);
+
+  // The current texture holds the state, the previous one can go
+  if (pingPong() && !prev_data_id_)
+    prev_data_id_ = GPUHelper::CreateTexture(width_, height_);
+  else if (!pingPong() && prev_data_id_)
+  {
+    glDeleteTextures(1, &prev_data_id_);
+    prev_data_id_ = 0;
+  }
+}
+
+void Automaton::swap()
+{
+  if (prev_data_id_)
+    std::swap(current_data_id_, prev_data_id_);
+}
+
+boolean Automaton::update()
+{
+  pollReload();
+
+  // Nothing to run until a reload fixes the sources
+  if (failed_programs_ > 0)
+    return false;
+
+  // The oldest batch in flight, polled without blocking
+  GLsync &fence = fences_[fence_index_];
+  if (fence)
+  {
+    if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+      return false;
+
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+
+  u64 target = frameGenerations();
+  if (target == 0)
+    return false;
+
+  update_timer_.startTime();
+  gpu_timer_.beginFrame();
+
+  // Batched backends may step past the target, one step at least
+  u64 first = loops_;
+  for (u64 done = 0; done < target;)
+  {
+    swap();
+
+    step();
+
+    // Only the first step is timed, the rest repeat its passes
+    if (done == 0)
+      gpu_timer_.endFrame();
+
+    u64 generations = generationsPerStep();
+    loops_ += generations;
+    done += generations;
+  }
+
+  // Once per batch, inside the loop the ring would fill in the first steps
+  // and the CPU backends upload their state for every one. Only while shown
+  if (stats_enabled_ && stats_program_)
+  {
+    present();
+    u64 measured = stats_.record(stats_program_, current_data_id_, width_, height_, loops_) ? 1 : 0;
+    stats_measured_ += measured;
+    stats_missed_ += loops_ - first - measured;
+  }
+
+  // Packed on the GPU now, written by a worker a few updates later
+  if (checkpoints_.due(loops_) && store_program_)
+  {
+    present();
+
+    std::vector<f32> params;
+    Snapshot::Header header = snapshotHeader(checkpoints_.compression(), params);
+    checkpoints_.capture(store_program_, current_data_id_, header, params);
+  }
+  checkpoints_.poll();
+
+  // The dispatches only sync compute with compute, the batch result is then
+  // sampled by the render or read back with glGetTexImage
+  glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+  fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  fence_index_ = (fence_index_ + 1) % SIM_FRAMES_IN_FLIGHT;
+
+  update_timer_.stopTime();
+  return true;
+}
+
+u64 Automaton::frameGenerations()
+{
+  if (target_hz_ <= 0.0f)
+    return static_cast<u64>(generations_per_frame_);
+
+  f64 seconds = 0.0;
+  if (frame_timed_)
+  {
+    frame_timer_.stopTime();
+    seconds = static_cast<f64>(frame_timer_.getElapsedTime(TimeCont::Precision::microseconds)) / 1.0e6;
+  }
+
+  frame_timer_.startTime();
+  frame_timed_ = true;
+
+  // A GPU that can not keep up does not build an ever growing debt
+  pending_generations_ = std::min(pending_generations_ + static_cast<f64>(target_hz_) * seconds, static_cast<f64>(MAX_GENERATIONS_PER_FRAME));
+
+  u64 generations = static_cast<u64>(pending_generations_);
+  pending_generations_ -= static_cast<f64>(generations);
+
+  return generations;
+}
+
+void Automaton::clearFences()
+{
+  for (GLsync &fence : fences_)
+  {
+    if (fence)
+      glDeleteSync(fence);
+    fence = nullptr;
+  }
+}
+
+void Automaton::setGenerationsPerFrame(u32 generations)
+{
+  generations_per_frame_ = static_cast<s32>(std::clamp(generations, 1u, static_cast<u32>(MAX_GENERATIONS_PER_FRAME)));
+}
+
+void Automaton::setTargetHz(f32 hz)
+{
+  target_hz_ = std::max(hz, 0.0f);
+  pending_generations_ = 0.0;
+  frame_timed_ = false;
+}
+
+void Automaton::bindImages()
+{
+  glBindImageTexture(CURR_IMG_BIND, current_data_id_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+  glBindImageTexture(PREV_IMG_BIND, prev_data_id_, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+}
+
+void Automaton::dispatch(u32 groups_x, u32 groups_y, u32 groups_z)
+{
+  glDispatchCompute(groups_x, groups_y, groups_z);
+  GLenum error = glGetError();
+  if (error != GL_NO_ERROR)
+    fprintf(stderr, "%s Compute Shader Dispatch Error: %d\n", name_, error);
+
+  // Next pass reads what this one wrote through images or SSBOs
+  glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void Automaton::dispatchCells(u32 cells_x, u32 cells_y)
+{
+  dispatch((cells_x + X_THREADS - 1) / X_THREADS, (cells_y + Y_THREADS - 1) / Y_THREADS);
+}
+
+void Automaton::imgui()
+{
+  ImGui::Begin("GPU Automata");
+
+  ImGui::Text("Type - %s", name_);
+  ImGui::Text("Grid: %ux%u", width_, height_);
+  ImGui::Text("Update time: %ld mcs", updateTime());
+  ImGui::Text("GPU time: %ld mcs", gpuTime());
+  for (size_t pass = 0; pass < gpu_timer_.passes(); pass++)
+    ImGui::BulletText("%s: %.1f mcs", gpu_timer_.passName(pass), static_cast<f64>(gpu_timer_.passTime(pass)) / 1000.0);
+  ImGui::Text("Generation: %llu", static_cast<unsigned long long>(loops_));
+
+  s32 seed = static_cast<s32>(seed_value_);
+  if (ImGui::InputInt("Seed", &seed))
+    seed_value_ = static_cast<u32>(seed);
+  if (ImGui::Button("Reseed"))
+    reset();
+
+  // Snapshot
+  /////////////////////////////////////////////////////////////////////////////
+  std::string snapshot = std::string(SNAPSHOT_DIR) + name_ + ".snap";
+  const char *compressions[] = {"Raw", "RLE", "Delta + RLE"};
+  ImGui::Combo("Snapshot compression", &snapshot_compression_, compressions, 3);
+  if (ImGui::Button("Save snapshot"))
+    save(snapshot, static_cast<u32>(snapshot_compression_));
+  ImGui::SameLine();
+  if (ImGui::Button("Load snapshot"))
+    load(snapshot);
+
+  s32 interval = static_cast<s32>(checkpoints_.interval());
+  s32 keep = static_cast<s32>(checkpoints_.keep());
+  boolean interval_edit = ImGui::InputInt("Checkpoint every (0 = off)", &interval, 1000, 10000);
+  boolean keep_edit = ImGui::SliderInt("Checkpoints kept", &keep, 1, 16);
+  if (interval_edit || keep_edit)
+    setCheckpoints(CHECKPOINT_DIR, static_cast<u64>(std::max(interval, 0)), static_cast<u32>(keep), static_cast<u32>(snapshot_compression_));
+  if (checkpoints_.interval())
+    ImGui::Text("Checkpoints: %llu written, %llu skipped", static_cast<unsigned long long>(checkpoints_.written()), static_cast<unsigned long long>(checkpoints_.skipped()));
+  /////////////////////////////////////////////////////////////////////////////
+
+  // Statistics
+  /////////////////////////////////////////////////////////////////////////////
+  ImGui::Checkbox("Statistics", &stats_enabled_);
+  if (stats_enabled_ && stats_.ready())
+  {
+    const GPUStats::Result &stats = stats_.last();
+    ImGui::Text("At generation %llu", static_cast<unsigned long long>(stats.generation));
+    ImGui::Text("Generations measured: %llu, missed: %llu", static_cast<unsigned long long>(stats_measured_), static_cast<unsigned long long>(stats_missed_));
+    ImGui::Text("Population: %u", stats.population);
+    ImGui::Text("Mass: %.2f", stats.mass);
+    ImGui::Text("Centroid: %.1f, %.1f", stats.centroid_x, stats.centroid_y);
+
+    f32 histogram[STATS_BINS];
+    for (u32 bin = 0; bin < STATS_BINS; bin++)
+      histogram[bin] = static_cast<f32>(stats.histogram[bin]);
+    ImGui::PlotHistogram("States", histogram, STATS_BINS, 0, nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 60.0f));
+
+    f64 step = static_cast<f64>(gpu_timer_.total());
+    ImGui::Text("Pass: %.1f mcs (%.1f%% of a step)", static_cast<f64>(stats.time) / 1000.0, step > 0.0 ? 100.0 * static_cast<f64>(stats.time) / step : 0.0);
+  }
+  /////////////////////////////////////////////////////////////////////////////
+
+  ImGui::SliderInt("Generations per frame", &generations_per_frame_, 1, MAX_GENERATIONS_PER_FRAME);
+  if (ImGui::SliderFloat("Target sim Hz (0 = per frame)", &target_hz_, 0.0f, 10000.0f))
+    setTargetHz(target_hz_);
+
+  imguiParams();
+
+  ImGui::End();
+}
+
+// Programs every automaton uses
+void Automaton::compileCommon()
+{
+  buildProgram(seed_program_, defines + LoadSourceFromFile(SHADER("ia/seed/seed_cs.glsl")), "seed program");
+  buildProgram(stats_program_, GPUStats::Source(), "stats program");
+  buildProgram(restore_program_, defines + LoadSourceFromFile(SHADER("ia/snapshot/restore_cs.glsl")), "restore program");
+  buildProgram(store_program_, defines + LoadSourceFromFile(SHADER("ia/snapshot/store_cs.glsl")), "store program");
+}
+
+// Writes both textures on the GPU, the state only depends on the seed and
+// the grid size
+void Automaton::seedTextures(s32 mode)
+{
+  if (!seed_program_)
+    return;
+
+  glUseProgram(seed_program_);
+
+  glBindImageTexture(CURR_IMG_BIND, current_data_id_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+  glBindImageTexture(PREV_IMG_BIND, prev_data_id_ ? prev_data_id_ : current_data_id_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+  glUniform1ui(glGetUniformLocation(seed_program_, "u_seed"), seed_value_);
+  glUniform1i(glGetUniformLocation(seed_program_, "u_mode"), mode);
+
+  dispatchCells(width_, height_);
+
+  glUseProgram(0);
+}
+
+void Automaton::reset()
+{
+  loops_ = 0;
+
+  seedTextures(seed_ == Seed::Binary ? SEED_BINARY : SEED_CONTINUOUS);
+  glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+  uploaded();
+}
+
+void Automaton::clean()
+{
+  if (GLEW_ARB_clear_texture)
+  {
+    glClearTexImage(current_data_id_, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    if (prev_data_id_)
+      glClearTexImage(prev_data_id_, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  }
+  else
+  {
+    seedTextures(SEED_CLEAR);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+  }
+
+  uploaded();
+}
+
+void Automaton::setSeed(u32 seed) { seed_value_ = seed; }
+
+u32 Automaton::seed() { return seed_value_; }
+
+void Automaton::setStats(boolean enabled) { stats_enabled_ = enabled; }
+
+boolean Automaton::statsEnabled() { return stats_enabled_; }
+
+boolean Automaton::statsReady() { return stats_.ready(); }
+
+const GPUStats::Result &Automaton::stats() { return stats_.last(); }
+
+u64 Automaton::statsMeasured() { return stats_measured_; }
+
+u64 Automaton::statsMissed() { return stats_missed_; }
+
+boolean Automaton::save(const std::string &path, u32 compression)
+{
+  if (!resident())
+    return false;
+
+  std::vector<u_byte> rgba(static_cast<size_t>(width_) * height_ * 4);
+  glBindTexture(GL_TEXTURE_2D, currentTexture());
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  std::vector<f32> params;
+  Snapshot::Header header = snapshotHeader(compression, params);
+
+  std::vector<u_byte> data;
+  Snapshot::Encode(rgba.data(), static_cast<size_t>(width_) * height_, header.encoding, compression, data);
+  header.data_size = data.size();
+
+  return Snapshot::Write(path, header, params, data);
+}
+
+Snapshot::Header Automaton::snapshotHeader(u32 compression, std::vector<f32> &params)
+{
+  Snapshot::Header header = {};
+  std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = SNAPSHOT_VERSION;
+  std::strncpy(header.name, name_, sizeof(header.name));
+  header.width = width_;
+  header.height = height_;
+  header.generation = loops_;
+  header.seed = seed_value_;
+  header.encoding = (seed_ == Seed::Binary) ? SNAPSHOT_BITS : SNAPSHOT_BYTES;
+  header.compression = compression;
+
+  saveParams(params);
+  header.params = static_cast<u32>(params.size());
+
+  size_t cells = static_cast<size_t>(width_) * height_;
+  header.cells_size = (header.encoding == SNAPSHOT_BITS) ? (cells + 7) / 8 : cells;
+
+  return header;
+}
+
+void Automaton::setCheckpoints(const std::string &directory, u64 interval, u32 keep, u32 compression)
+{
+  checkpoints_.configure(directory, interval, keep, compression);
+}
+
+const std::string &Automaton::lastCheckpoint() { return checkpoints_.last(); }
+
+boolean Automaton::load(const std::string &path)
+{
+  MappedFile file;
+  if (!file.open(path))
+  {
+    fprintf(stderr, "Can not open the snapshot %s\n", path.c_str());
+    return false;
+  }
+
+  Snapshot::Header header;
+  const u_byte *params_data = nullptr;
+  const u_byte *data = nullptr;
+  if (!Snapshot::Parse(file.data(), file.size(), header, params_data, data))
+  {
+    fprintf(stderr, "%s is not a version %d snapshot\n", path.c_str(), SNAPSHOT_VERSION);
+    return false;
+  }
+
+  if (std::strncmp(header.name, name_, sizeof(header.name)))
+  {
+    fprintf(stderr, "%s holds a %.32s grid, not %s\n", path.c_str(), header.name, name_);
+    return false;
+  }
+
+  // Checked before the running grid is touched, a raw file goes to the GPU
+  // straight from the mapping
+  std::vector<u_byte> cells;
+  const u_byte *upload = data;
+  if (header.compression != SNAPSHOT_RAW)
+  {
+    if (!Snapshot::Decompress(data, header.data_size, header.compression, header.cells_size, cells))
+    {
+      fprintf(stderr, "%s is corrupt\n", path.c_str());
+      return false;
+    }
+    upload = cells.data();
+  }
+
+  if (!resident())
+    init(Math::Vec2(static_cast<f32>(header.width), static_cast<f32>(header.height)));
+  else
+    resize(header.width, header.height);
+
+  if (width_ != header.width || height_ != header.height || !restore_program_)
+    return false;
+
+  std::vector<f32> params(header.params);
+  std::memcpy(params.data(), params_data, params.size() * sizeof(f32));
+  loadParams(params);
+
+  // The shader reads whole words
+  u32 buffer = 0;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>((header.cells_size + 3) & ~u64{3}), nullptr, GL_STREAM_DRAW);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(header.cells_size), upload);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+  glUseProgram(restore_program_);
+
+  glBindImageTexture(CURR_IMG_BIND, current_data_id_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+  glBindImageTexture(PREV_IMG_BIND, prev_data_id_ ? prev_data_id_ : current_data_id_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SNAPSHOT_BIND, buffer);
+  glUniform1i(glGetUniformLocation(restore_program_, "u_encoding"), static_cast<s32>(header.encoding));
+
+  dispatchCells(width_, height_);
+  glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+  glUseProgram(0);
+  glDeleteBuffers(1, &buffer);
+
+  loops_ = header.generation;
+  seed_value_ = header.seed;
+  uploaded();
+
+  return true;
+}
+
+u32 Automaton::currentTexture()
+{
+  present();
+  return current_data_id_;
+}
+
+u32 Automaton::width() { return width_; }
+
+u32 Automaton::height() { return height_; }
+
+u64 Automaton::generation() { return loops_; }
+
+size_t Automaton::updateTime() { return update_timer_.getElapsedTime(TimeCont::Precision::microseconds); }
+
+size_t Automaton::gpuTime() { return static_cast<size_t>(gpu_timer_.total() / 1000); }
+
+size_t Automaton::gpuBytes()
+{
+  if (!resident())
+    return 0;
+
+  size_t textures = prev_data_id_ ? 2 : 1;
+  return static_cast<size_t>(width_) * height_ * 4 * textures + resourceBytes();
+}
+
+const char *Automaton::name() { return name_; }
@@ -0,0 +1,209 @@
+#include "ia/checkpoint_writer.h"
+#include <filesystem>
+
+CheckpointWriter::CheckpointWriter()
+    : interval_(0), next_(0), keep_(CHECKPOINT_KEEP), compression_(SNAPSHOT_RLE),
+      buffer_(0), buffer_size_(0), fence_(nullptr), pending_header_{}, last_generation_(0), written_(0), skipped_(0) {}
+
+CheckpointWriter::~CheckpointWriter() { finish(true); }
+
+void CheckpointWriter::configure(const std::string &directory, u64 interval, u32 keep, u32 compression)
+{
+  directory_ = directory;
+  interval_ = interval;
+  next_ = 0;
+  keep_ = std::max(keep, 1u);
+  compression_ = compression;
+}
+
+u64 CheckpointWriter::interval() { return interval_; }
+
+u32 CheckpointWriter::keep() { return keep_; }
+
+u32 CheckpointWriter::compression() { return compression_; }
+
+boolean CheckpointWriter::due(u64 generation)
+{
+  if (!interval_)
+    return false;
+
+  // Just configured, reset or restored to an earlier generation
+  if (next_ == 0 || next_ > generation + interval_)
+    next_ = (generation / interval_ + 1) * interval_;
+
+  return generation >= next_;
+}
+
+void CheckpointWriter::capture(u32 program, u32 texture, const Snapshot::Header &header, const std::vector<f32> &params)
+{
+  next_ = (header.generation / interval_ + 1) * interval_;
+
+  if (fence_)
+  {
+    skipped_++;
+    return;
+  }
+
+  // The shader writes whole words
+  size_t size = static_cast<size_t>((header.cells_size + 3) & ~u64{3});
+  if (!buffer_)
+    glGenBuffers(1, &buffer_);
+
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer_);
+  if (buffer_size_ != size)
+  {
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_READ);
+    buffer_size_ = size;
+  }
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+  glUseProgram(program);
+
+  glBindImageTexture(PREV_IMG_BIND, texture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SNAPSHOT_BIND, buffer_);
+  glUniform1i(glGetUniformLocation(program, "u_encoding"), static_cast<s32>(header.encoding));
+
+  // One word per invocation, in rows of at most 65535 groups
+  u32 groups = static_cast<u32>((size / 4 + SNAPSHOT_THREADS - 1) / SNAPSHOT_THREADS);
+  u32 groups_x = std::min(groups, 65535u);
+  glDispatchCompute(groups_x, (groups + groups_x - 1) / groups_x, 1);
+
+  glUseProgram(0);
+
+  // Read with glGetBufferSubData once the fence signals
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+  fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  pending_header_ = header;
+  pending_header_.compression = compression_;
+  pending_params_ = params;
+}
+
+void CheckpointWriter::poll()
+{
+  finish(false);
+
+  if (!fence_ || glClientWaitSync(fence_, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+    return;
+
+  glDeleteSync(fence_);
+  fence_ = nullptr;
+
+  // Both slots still writing, the disk can not keep up with the interval
+  u32 free_slot = 0;
+  while (free_slot < 2 && slots_[free_slot].result.valid())
+    free_slot++;
+
+  if (free_slot == 2)
+  {
+    skipped_++;
+    return;
+  }
+
+  Slot &slot = slots_[free_slot];
+  slot.header = pending_header_;
+  slot.params = pending_params_;
+  slot.cells.resize(static_cast<size_t>(pending_header_.cells_size));
+
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer_);
+  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(slot.cells.size()), slot.cells.data());
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+  // Names sort by generation, the rotation relies on it
+  std::string prefix = std::string(slot.header.name, strnlen(slot.header.name, sizeof(slot.header.name))) + "_";
+  byte generation[32];
+  snprintf(generation, sizeof(generation), "%016llu", static_cast<unsigned long long>(slot.header.generation));
+
+  writing_[free_slot] = directory_ + "/" + prefix + generation + ".snap";
+
+  // Half the cores can be no TaskManager worker at all
+  if (std::thread::hardware_concurrency() / 2 == 0)
+  {
+    std::promise<boolean> written;
+    written.set_value(Write(&slot, writing_[free_slot], directory_, prefix, keep_));
+    slot.result = written.get_future();
+    return;
+  }
+
+  slot.result = TM->enqueue(&CheckpointWriter::Write, &slot, writing_[free_slot], directory_, prefix, keep_);
+}
+
+void CheckpointWriter::finish(boolean wait)
+{
+  for (u32 i = 0; i < 2; i++)
+  {
+    Slot &slot = slots_[i];
+    if (!slot.result.valid())
+      continue;
+
+    if (!wait && slot.result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+      continue;
+
+    if (slot.result.get())
+    {
+      written_++;
+
+      // Both slots can finish in the same poll, in either order
+      if (last_.empty() || slot.header.generation > last_generation_)
+      {
+        last_ = writing_[i];
+        last_generation_ = slot.header.generation;
+      }
+    }
+    else
+      skipped_++;
+  }
+}
+
+// Worker thread
+boolean CheckpointWriter::Write(Slot *slot, std::string path, std::string directory, std::string prefix, u32 keep)
+{
+  std::vector<u_byte> data;
+  Snapshot::Compress(slot->cells, slot->header.compression, data);
+  slot->header.data_size = data.size();
+
+  boolean written = Snapshot::Write(path, slot->header, slot->params, data);
+
+  // Raw moves the cells out, keep the allocation for the next checkpoint
+  if (slot->header.compression == SNAPSHOT_RAW)
+    slot->cells.swap(data);
+
+  if (!written)
+    return false;
+
+  // Oldest first
+  std::error_code error;
+  std::vector<std::filesystem::path> files;
+  for (const auto &entry : std::filesystem::directory_iterator(directory, error))
+  {
+    std::string name = entry.path().filename().string();
+    if (entry.path().extension() == ".snap" && !name.compare(0, prefix.size(), prefix))
+      files.push_back(entry.path());
+  }
+
+  std::sort(files.begin(), files.end());
+  for (size_t i = 0; i + keep < files.size(); i++)
+    std::filesystem::remove(files[i], error);
+
+  return true;
+}
+
+u64 CheckpointWriter::written() { return written_; }
+
+u64 CheckpointWriter::skipped() { return skipped_; }
+
+const std::string &CheckpointWriter::last() { return last_; }
+
+void CheckpointWriter::release()
+{
+  finish(true);
+
+  if (fence_)
+    glDeleteSync(fence_);
+  if (buffer_)
+    glDeleteBuffers(1, &buffer_);
+
+  fence_ = nullptr;
+  buffer_ = 0;
+  buffer_size_ = 0;
+}
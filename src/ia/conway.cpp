@@ -2,143 +2,309 @@
 #include "ia/gpu_helper.h"
 #include "ia/defines.h"
 
-Conway::Conway() {}
+Conway::Conway()
+    : Automaton("Conway", Seed::Binary), compute_program_(0), tiled_program_(0), temporal_steps_(4),
+      packed_program_(0), pack_program_(0), unpack_program_(0),
+      packed_prev_ssbo_(0), packed_curr_ssbo_(0), words_(0),
+      backend_(Backend::Texture), hashlife_mb_(512), dirty_(false) {}
 
-void Conway::init(Math::Vec2 win)
+Conway::~Conway() {}
+
+void Conway::setBackend(Backend backend)
 {
-  loops_ = 0;
-  width_ = static_cast<u32>(win.x);
-  height_ = static_cast<u32>(win.y);
+  if (backend == backend_)
+    return;
 
-  u_byte *data = reinterpret_cast<u_byte *>(std::calloc(width_ * height_ * 4, sizeof(u_byte)));
+  // Bring the state back to the texture before leaving the backend, the new
+  // one continues from that generation
+  present();
 
-  if (!data)
-  {
-    width_ = 0;
-    height_ = 0;
+  backend_ = backend;
+  allocateTextures();
+
+  if (backend_ == Backend::Packed)
+    initPacked();
+
+  uploaded();
+}
 
+void Conway::initPacked()
+{
+  if (packed_prev_ssbo_)
     return;
-  }
 
-  current_data_id_ = GPUHelper::CreateTexture(width_, height_, data);
-  prev_data_id_ = GPUHelper::CreateTexture(width_, height_, data);
+  // Packed state
+  /////////////////////////////////////////////////////////////////////////////
+  words_ = (width_ + 31) / 32;
 
-  DESTROY(data);
+  glGenBuffers(1, &packed_prev_ssbo_);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, packed_prev_ssbo_);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, words_ * height_ * sizeof(u32), nullptr, GL_DYNAMIC_COPY);
 
-  compileShaders();
+  glGenBuffers(1, &packed_curr_ssbo_);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, packed_curr_ssbo_);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, words_ * height_ * sizeof(u32), nullptr, GL_DYNAMIC_COPY);
 
-  glUseProgram(compute_program_);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  /////////////////////////////////////////////////////////////////////////////
+}
 
-  reset();
+// The packed buffers only exist while the backend is in use or was used
+void Conway::initResources()
+{
+  if (backend_ == Backend::Packed)
+    initPacked();
 }
 
-Conway::~Conway() {}
+void Conway::releaseResources()
+{
+  if (!packed_prev_ssbo_)
+    return;
+
+  glDeleteBuffers(1, &packed_prev_ssbo_);
+  glDeleteBuffers(1, &packed_curr_ssbo_);
+  packed_prev_ssbo_ = 0;
+  packed_curr_ssbo_ = 0;
+}
+
+size_t Conway::resourceBytes()
+{
+  return packed_prev_ssbo_ ? static_cast<size_t>(words_) * height_ * sizeof(u32) * 2 : 0;
+}
+
+void Conway::uploadPackedUniforms(u32 program)
+{
+  u32 tail = width_ % 32;
 
-void Conway::swap()
+  glUniform1i(glGetUniformLocation(program, "u_words"), static_cast<s32>(words_));
+  glUniform1i(glGetUniformLocation(program, "u_width"), static_cast<s32>(width_));
+  glUniform1i(glGetUniformLocation(program, "u_height"), static_cast<s32>(height_));
+  glUniform1ui(glGetUniformLocation(program, "u_last_mask"), tail ? ((1u << tail) - 1u) : ~0u);
+}
+
+// Packs the current texture into the current SSBO
+void Conway::pack()
+{
+  glUseProgram(pack_program_);
+
+  glBindImageTexture(PREV_IMG_BIND, current_data_id_, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PACKED_CURR_BIND, packed_curr_ssbo_);
+  uploadPackedUniforms(pack_program_);
+
+  dispatchCells(words_, height_);
+
+  glUseProgram(0);
+}
+
+Conway::Backend Conway::backend() { return backend_; }
+
+// Packed, CPU and Hashlife step their own state, the texture only shows it
+boolean Conway::pingPong() { return backend_ == Backend::Texture || backend_ == Backend::Tiled; }
+
+void Conway::setStepLog2(u32 k) { hashlife_.setStepLog2(k); }
+
+void Conway::setTemporalSteps(s32 steps) { temporal_steps_ = std::clamp(steps, 1, MAX_TEMPORAL_STEPS); }
+
+u64 Conway::generationsPerStep()
 {
-  std::swap(current_data_id_, prev_data_id_);
+  if (backend_ == Backend::Hashlife)
+    return u64{1} << hashlife_.stepLog2();
+
+  if (backend_ == Backend::Tiled)
+    return static_cast<u64>(temporal_steps_);
+
+  return 1;
 }
 
-void Conway::update()
+void Conway::step()
 {
-  update_timer_.startTime();
-  loops_++;
-  
-  swap();
+  if (backend_ == Backend::Packed)
+  {
+    std::swap(packed_prev_ssbo_, packed_curr_ssbo_);
+
+    glUseProgram(packed_program_);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PACKED_PREV_BIND, packed_prev_ssbo_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PACKED_CURR_BIND, packed_curr_ssbo_);
+    uploadPackedUniforms(packed_program_);
 
-  GLenum error = GL_NO_ERROR;
+    gpu_timer_.begin("Packed update");
+    dispatchCells(words_, height_);
+    gpu_timer_.end();
+
+    glUseProgram(0);
+
+    dirty_ = true;
+    return;
+  }
+
+  if (backend_ == Backend::CPU)
+  {
+    cpu_.step();
+    dirty_ = true;
+    return;
+  }
+
+  if (backend_ == Backend::Hashlife)
+  {
+    hashlife_.step();
+    dirty_ = true;
+    return;
+  }
+
+  if (backend_ == Backend::Tiled)
+  {
+    glUseProgram(tiled_program_);
+
+    bindImages();
+    glUniform1i(glGetUniformLocation(tiled_program_, "u_steps"), temporal_steps_);
+
+    gpu_timer_.begin("Tiled update");
+    dispatch((width_ + TILE_SIZE - 1) / TILE_SIZE, (height_ + TILE_SIZE - 1) / TILE_SIZE);
+    gpu_timer_.end();
+
+    glUseProgram(0);
+    return;
+  }
 
   // GPU Automata
   /////////////////////////////////////////////////////////////////////////////
   glUseProgram(compute_program_);
 
-  glBindImageTexture(CURR_IMG_BIND, current_data_id_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
-  glBindImageTexture(PREV_IMG_BIND, prev_data_id_, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+  bindImages();
 
   // Dispatch Compute Shader with appropriate workgroup sizes
-  glDispatchCompute(width_ / X_THREADS, height_ / Y_THREADS, 1);
-  error = glGetError();
-  if (error != GL_NO_ERROR)
-    fprintf(stderr, "Compute Shader Dispatch Error: %d\n", error);
-
-  glMemoryBarrier(GL_ALL_BARRIER_BITS);
+  gpu_timer_.begin("Update");
+  dispatchCells(width_, height_);
+  gpu_timer_.end();
 
   glUseProgram(0);
   /////////////////////////////////////////////////////////////////////////////
-
-  glFinish();
-  update_timer_.stopTime();
 }
 
-void Conway::imgui()
+void Conway::imguiParams()
 {
-  ImGui::Begin("GPU Automata");
+  const char *backends[] = {"Texture", "Texture tiled", "GPU bit-packed", "CPU bit-packed", "Hashlife"};
+  s32 backend = static_cast<s32>(backend_);
+  if (ImGui::Combo("Backend", &backend, backends, 5))
+    setBackend(static_cast<Backend>(backend));
+
+  if (backend_ == Backend::Tiled)
+    ImGui::SliderInt("Generations per dispatch", &temporal_steps_, 1, MAX_TEMPORAL_STEPS);
+
+  if (backend_ == Backend::Hashlife)
+  {
+    s32 k = static_cast<s32>(hashlife_.stepLog2());
+    if (ImGui::SliderInt("Step 2^k", &k, 0, 30))
+      hashlife_.setStepLog2(static_cast<u32>(k));
 
-  ImGui::Text("Type - Conway");
-  ImGui::Text("Update time: %ld mcs", update_timer_.getElapsedTime(TimeCont::Precision::microseconds));
-  ImGui::Text("Generation: %d", loops_);
+    if (ImGui::SliderInt("Memory limit (MB)", &hashlife_mb_, 16, 4096))
+      hashlife_.setMaxBytes(static_cast<size_t>(hashlife_mb_) << 20);
 
-  ImGui::End();
+    ImGui::Text("Population: %llu", static_cast<unsigned long long>(hashlife_.population()));
+    ImGui::Text("Nodes: %zu (%zu MB)", hashlife_.nodes(), hashlife_.bytes() >> 20);
+  }
 }
 
-void Conway::reset()
+void Conway::saveParams(std::vector<f32> &params)
 {
-  loops_ = 0;
-  u_byte *data = reinterpret_cast<u_byte *>(std::calloc(width_ * height_ * 4, sizeof(u_byte)));
-
-  if (!data)
-    return;
+  params = {static_cast<f32>(temporal_steps_), static_cast<f32>(hashlife_.stepLog2())};
+}
 
-  u_byte alive = 255;
-  u_byte dead = 0;
+void Conway::loadParams(const std::vector<f32> &params)
+{
+  if (params.size() > 0)
+    setTemporalSteps(static_cast<s32>(params[0]));
+  if (params.size() > 1)
+    setStepLog2(static_cast<u32>(params[1]));
+}
 
-  for (u32 i = 0; i < width_ * height_ * 4; i += 4)
+// The state is seeded on the GPU, the CPU backends read it back
+void Conway::uploaded()
+{
+  if (backend_ == Backend::CPU || backend_ == Backend::Hashlife)
   {
-    data[i + 0] = alive;
-    data[i + 1] = alive;
-    data[i + 2] = alive;
+    staging_.resize(static_cast<size_t>(width_) * height_ * 4);
 
-    data[i + 3] = (rand() % 5 < 2) ? alive : dead;
+    glBindTexture(GL_TEXTURE_2D, current_data_id_);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, staging_.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
   }
 
-  glBindTexture(GL_TEXTURE_2D, current_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+  if (backend_ == Backend::CPU)
+  {
+    cpu_.init(width_, height_);
+    cpu_.load(staging_.data());
+  }
 
-  glBindTexture(GL_TEXTURE_2D, prev_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+  if (backend_ == Backend::Hashlife)
+    hashlife_.load(staging_.data(), width_, height_);
 
-  glBindTexture(GL_TEXTURE_2D, 0);
+  if (backend_ == Backend::Packed)
+    pack();
 
-  DESTROY(data);
+  dirty_ = false;
 }
 
-void Conway::clean()
+void Conway::present()
 {
-  u_byte *data = reinterpret_cast<u_byte *>(std::calloc(width_ * height_ * 4, sizeof(u_byte)));
+  if (backend_ == Backend::Texture || !dirty_)
+    return;
 
-  if (!data)
+  if (backend_ == Backend::Packed)
+  {
+    glUseProgram(unpack_program_);
+
+    glBindImageTexture(CURR_IMG_BIND, current_data_id_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PACKED_CURR_BIND, packed_curr_ssbo_);
+    uploadPackedUniforms(unpack_program_);
+
+    dispatchCells(width_, height_);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+    glUseProgram(0);
+
+    dirty_ = false;
     return;
+  }
 
-  glBindTexture(GL_TEXTURE_2D, current_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+  staging_.resize(static_cast<size_t>(width_) * height_ * 4);
 
-  glBindTexture(GL_TEXTURE_2D, prev_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+  if (backend_ == Backend::CPU)
+    cpu_.store(staging_.data());
+  else
+    hashlife_.store(staging_.data(), width_, height_);
 
+  glBindTexture(GL_TEXTURE_2D, current_data_id_);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, staging_.data());
   glBindTexture(GL_TEXTURE_2D, 0);
 
-  DESTROY(data);
+  dirty_ = false;
 }
 
-u32 Conway::currentTexture() { return current_data_id_; }
-
 void Conway::compileShaders()
 {
   // Compute shader
   /////////////////////////////////////////////////////////////////////////////
   std::string conway_string = defines + LoadSourceFromFile(SHADER("ia/conway/conway_cs.glsl"));
-  const char *conway_cs = conway_string.c_str();
-  GLuint compute_shader = GPUHelper::CompileShader(GL_COMPUTE_SHADER, conway_cs, "conway shader");
-  compute_program_ = GPUHelper::CreateProgram(compute_shader, "conway program");
+  buildProgram(compute_program_, conway_string, "conway program");
+  /////////////////////////////////////////////////////////////////////////////
+
+  // Tiled compute shader
+  /////////////////////////////////////////////////////////////////////////////
+  std::string tiled_string = defines + LoadSourceFromFile(SHADER("ia/conway/conway_tiled_cs.glsl"));
+  buildProgram(tiled_program_, tiled_string, "conway tiled program");
+  /////////////////////////////////////////////////////////////////////////////
+
+  // Packed compute shaders
+  /////////////////////////////////////////////////////////////////////////////
+  std::string packed_string = defines + LoadSourceFromFile(SHADER("ia/conway/conway_packed_cs.glsl"));
+  buildProgram(packed_program_, packed_string, "conway packed program");
+
+  std::string pack_string = defines + LoadSourceFromFile(SHADER("ia/conway/conway_pack_cs.glsl"));
+  buildProgram(pack_program_, pack_string, "conway pack program");
+
+  std::string unpack_string = defines + LoadSourceFromFile(SHADER("ia/conway/conway_unpack_cs.glsl"));
+  buildProgram(unpack_program_, unpack_string, "conway unpack program");
   /////////////////////////////////////////////////////////////////////////////
 }
@@ -0,0 +1,183 @@
+#include "ia/conway_cpu.h"
+#include <bit>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+ConwayCPU::ConwayCPU() : width_(0), height_(0), words_(0), stride_(0), last_mask_(0) {}
+
+ConwayCPU::~ConwayCPU() {}
+
+void ConwayCPU::init(u32 width, u32 height)
+{
+  width_ = width;
+  height_ = height;
+  words_ = (width_ + 63) / 64;
+  stride_ = words_ + 2;
+
+  u32 tail = width_ % 64;
+  last_mask_ = tail ? ((u64{1} << tail) - 1) : ~u64{0};
+
+  prev_.assign(static_cast<size_t>(stride_) * (height_ + 2), 0);
+  current_.assign(static_cast<size_t>(stride_) * (height_ + 2), 0);
+}
+
+u64 *ConwayCPU::row(std::vector<u64> &grid, u32 y)
+{
+  return grid.data() + static_cast<size_t>(y + 1) * stride_ + 1;
+}
+
+// Bit i of the word k is the cell k * 64 + i, so the west neighbour comes
+// from a left shift and the east one from a right shift, carrying the bit of
+// the adjacent word. The three rows are reduced with full adders to the bits
+// of the count and the B3/S23 rule is evaluated on those bits:
+//   total = a0 + 2 * (u1 + d1 + m1 + c0)
+//   alive = (u1 + d1 + m1 + c0 == 1) & (a0 | cell)
+#define CONWAY_RULE(SHL, SHR, XOR, AND, OR, ANDNOT, up, mid, dn, out)          \
+  {                                                                            \
+    auto ul = OR(SHL(up##_c, 1), SHR(up##_w, 63));                             \
+    auto ur = OR(SHR(up##_c, 1), SHL(up##_e, 63));                             \
+    auto ml = OR(SHL(mid##_c, 1), SHR(mid##_w, 63));                           \
+    auto mr = OR(SHR(mid##_c, 1), SHL(mid##_e, 63));                           \
+    auto dl = OR(SHL(dn##_c, 1), SHR(dn##_w, 63));                             \
+    auto dr = OR(SHR(dn##_c, 1), SHL(dn##_e, 63));                             \
+                                                                               \
+    auto u0 = XOR(XOR(ul, up##_c), ur);                                        \
+    auto u1 = OR(AND(ul, up##_c), AND(ur, XOR(ul, up##_c)));                   \
+    auto d0 = XOR(XOR(dl, dn##_c), dr);                                        \
+    auto d1 = OR(AND(dl, dn##_c), AND(dr, XOR(dl, dn##_c)));                   \
+    auto m0 = XOR(ml, mr);                                                     \
+    auto m1 = AND(ml, mr);                                                     \
+                                                                               \
+    auto a0 = XOR(XOR(u0, d0), m0);                                            \
+    auto c0 = OR(AND(u0, d0), AND(m0, XOR(u0, d0)));                           \
+                                                                               \
+    auto p = XOR(u1, d1);                                                      \
+    auto q = XOR(m1, c0);                                                      \
+    auto two = OR(AND(u1, d1), AND(m1, c0));                                   \
+                                                                               \
+    out = AND(ANDNOT(two, XOR(p, q)), OR(a0, mid##_c));                        \
+  }
+
+#define U64_SHL(a, n) ((a) << (n))
+#define U64_SHR(a, n) ((a) >> (n))
+#define U64_XOR(a, b) ((a) ^ (b))
+#define U64_AND(a, b) ((a) & (b))
+#define U64_OR(a, b) ((a) | (b))
+#define U64_ANDNOT(a, b) (~(a) & (b))
+
+void ConwayCPU::stepRows(u32 begin, u32 end)
+{
+  for (u32 y = begin; y < end; y++)
+  {
+    const u64 *up = row(prev_, y) - stride_;
+    const u64 *mid = row(prev_, y);
+    const u64 *dn = row(prev_, y) + stride_;
+    u64 *out = row(current_, y);
+
+    u32 k = 0;
+
+#if defined(__AVX2__)
+    for (; k + 4 <= words_; k += 4)
+    {
+      __m256i up_w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(up + k - 1));
+      __m256i up_c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(up + k));
+      __m256i up_e = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(up + k + 1));
+      __m256i mid_w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mid + k - 1));
+      __m256i mid_c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mid + k));
+      __m256i mid_e = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mid + k + 1));
+      __m256i dn_w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dn + k - 1));
+      __m256i dn_c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dn + k));
+      __m256i dn_e = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dn + k + 1));
+
+      __m256i next;
+      CONWAY_RULE(_mm256_slli_epi64, _mm256_srli_epi64, _mm256_xor_si256, _mm256_and_si256,
+                  _mm256_or_si256, _mm256_andnot_si256, up, mid, dn, next);
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + k), next);
+    }
+#endif
+
+    for (; k < words_; k++)
+    {
+      const u64 *u = up + k, *m = mid + k, *d = dn + k;
+      u64 up_w = u[-1], up_c = u[0], up_e = u[1];
+      u64 mid_w = m[-1], mid_c = m[0], mid_e = m[1];
+      u64 dn_w = d[-1], dn_c = d[0], dn_e = d[1];
+
+      CONWAY_RULE(U64_SHL, U64_SHR, U64_XOR, U64_AND, U64_OR, U64_ANDNOT, up, mid, dn, out[k]);
+    }
+
+    // Bits past the width must stay dead, they are read as neighbours
+    out[words_ - 1] &= last_mask_;
+  }
+}
+
+void ConwayCPU::step()
+{
+  if (width_ == 0 || height_ == 0)
+    return;
+
+  std::swap(prev_, current_);
+
+  // Split the rows in bands for the TaskManager workers
+  u32 bands = std::min(std::thread::hardware_concurrency() / 2, height_);
+  if (bands <= 1)
+  {
+    stepRows(0, height_);
+    return;
+  }
+
+  std::vector<std::future<void>> tasks;
+  u32 band_rows = (height_ + bands - 1) / bands;
+  for (u32 begin = 0; begin < height_; begin += band_rows)
+    tasks.push_back(TM->enqueue(&ConwayCPU::stepRows, this, begin, std::min(begin + band_rows, height_)));
+
+  for (auto &task : tasks)
+    task.wait();
+}
+
+void ConwayCPU::load(const u_byte *rgba)
+{
+  std::fill(current_.begin(), current_.end(), 0);
+
+  for (u32 y = 0; y < height_; y++)
+  {
+    u64 *dst = row(current_, y);
+    const u_byte *src = rgba + static_cast<size_t>(y) * width_ * 4;
+
+    for (u32 x = 0; x < width_; x++)
+      if (src[x * 4 + 3] > 127)
+        dst[x / 64] |= u64{1} << (x % 64);
+  }
+}
+
+void ConwayCPU::store(u_byte *rgba)
+{
+  u_byte alive = 255;
+  u_byte dead = 0;
+
+  for (u32 y = 0; y < height_; y++)
+  {
+    const u64 *src = row(current_, y);
+    u_byte *dst = rgba + static_cast<size_t>(y) * width_ * 4;
+
+    for (u32 x = 0; x < width_; x++)
+    {
+      dst[x * 4 + 0] = alive;
+      dst[x * 4 + 1] = alive;
+      dst[x * 4 + 2] = alive;
+      dst[x * 4 + 3] = ((src[x / 64] >> (x % 64)) & 1) ? alive : dead;
+    }
+  }
+}
+
+u64 ConwayCPU::population()
+{
+  u64 total = 0;
+  for (u64 word : current_)
+    total += static_cast<u64>(std::popcount(word));
+
+  return total;
+}
@@ -0,0 +1,143 @@
+#include "ia/fft.h"
+
+FFT::FFT() : size_(0) {}
+
+FFT::~FFT() {}
+
+void FFT::init(u32 size)
+{
+  size_ = size;
+  factors_.clear();
+
+  // Radix 4 first, it does the most work per pass
+  u32 rest = size;
+  while (rest % 4 == 0 && rest > 1)
+  {
+    factors_.push_back(4);
+    rest /= 4;
+  }
+
+  for (u32 radix = 2; rest > 1; radix++)
+  {
+    while (rest % radix == 0)
+    {
+      factors_.push_back(radix);
+      rest /= radix;
+    }
+  }
+
+  twiddles_.resize(size_);
+  for (u32 k = 0; k < size_; k++)
+  {
+    f64 angle = -2.0 * M_PI * static_cast<f64>(k) / static_cast<f64>(size_);
+    twiddles_[k] = Complex(static_cast<f32>(cos(angle)), static_cast<f32>(sin(angle)));
+  }
+}
+
+u32 FFT::size() { return size_; }
+
+void FFT::forward(Complex *data, Complex *scratch) { transform(data, scratch, false); }
+
+void FFT::inverse(Complex *data, Complex *scratch) { transform(data, scratch, true); }
+
+void FFT::transform(Complex *data, Complex *scratch, boolean inverse)
+{
+  Complex *src = data;
+  Complex *dst = scratch;
+
+  u32 span = 1;
+  for (u32 radix : factors_)
+  {
+    pass(src, dst, radix, span, inverse);
+    std::swap(src, dst);
+    span *= radix;
+  }
+
+  if (src != data)
+    std::copy(src, src + size_, data);
+}
+
+// One Stockham pass: size / radix butterflies of length radix, each one
+// reading with stride size / radix and writing its outputs span apart, so
+// the result ends in natural order without a bit reversal
+void FFT::pass(const Complex *src, Complex *dst, u32 radix, u32 span, boolean inverse)
+{
+  u32 groups = size_ / radix;
+  u32 stride = size_ / (span * radix);
+
+  Complex small[4];
+  std::vector<Complex> large;
+  Complex *v = small;
+  if (radix > 4)
+  {
+    large.resize(radix * 2);
+    v = large.data();
+  }
+
+  auto twiddle = [&](u32 index) { return inverse ? std::conj(twiddles_[index]) : twiddles_[index]; };
+
+  for (u32 j = 0; j < groups; j++)
+  {
+    u32 k = j % span;
+
+    v[0] = src[j];
+    for (u32 r = 1; r < radix; r++)
+      v[r] = (k == 0) ? src[j + r * groups] : src[j + r * groups] * twiddle(r * k * stride);
+
+    switch (radix)
+    {
+    case 2:
+    {
+      Complex a = v[0];
+      v[0] = a + v[1];
+      v[1] = a - v[1];
+      break;
+    }
+    case 3:
+    {
+      const f32 c = -0.5f;
+      const f32 s = inverse ? 0.86602540378f : -0.86602540378f;
+      Complex sum = v[1] + v[2];
+      Complex diff = v[1] - v[2];
+      Complex rotated = Complex(-diff.imag() * s, diff.real() * s);
+      Complex mid = v[0] + sum * c;
+      v[0] = v[0] + sum;
+      v[1] = mid + rotated;
+      v[2] = mid - rotated;
+      break;
+    }
+    case 4:
+    {
+      Complex t0 = v[0] + v[2];
+      Complex t1 = v[0] - v[2];
+      Complex t2 = v[1] + v[3];
+      Complex d = v[1] - v[3];
+      Complex t3 = inverse ? Complex(-d.imag(), d.real()) : Complex(d.imag(), -d.real());
+      v[0] = t0 + t2;
+      v[1] = t1 + t3;
+      v[2] = t0 - t2;
+      v[3] = t1 - t3;
+      break;
+    }
+    default:
+    {
+      // Plain DFT of the factor, roots taken from the size_ table
+      Complex *out = v + radix;
+      u32 root = size_ / radix;
+      for (u32 q = 0; q < radix; q++)
+      {
+        Complex sum = v[0];
+        for (u32 r = 1; r < radix; r++)
+          sum += v[r] * twiddle(((r * q) % radix) * root);
+        out[q] = sum;
+      }
+      std::copy(out, out + radix, v);
+      break;
+    }
+    }
+
+    Complex *base = dst + (j - k) * radix + k;
+    for (u32 r = 0; r < radix; r++)
+      base[r * span] = v[r];
+  }
+}
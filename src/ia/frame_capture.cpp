@@ -0,0 +1,124 @@
+#include "ia/frame_capture.h"
+
+FrameCapture::FrameCapture() : buffers_{}, current_(0), spare_(nullptr), captured_(0), dropped_(0)
+{
+  for (auto &frame : pool_)
+  {
+    frame = std::make_unique<CapturedFrame>();
+    free_.push(frame.get());
+  }
+}
+
+FrameCapture::~FrameCapture() {}
+
+void FrameCapture::capture(u32 texture, u32 width, u32 height, u64 generation)
+{
+  poll();
+
+  Buffer &buffer = buffers_[current_];
+  if (buffer.fence)
+  {
+    dropped_++;
+    return;
+  }
+
+  size_t size = static_cast<size_t>(width) * height * 4;
+  if (!buffer.pbo)
+    glGenBuffers(1, &buffer.pbo);
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.pbo);
+  if (buffer.size != size)
+  {
+    glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_READ);
+    buffer.size = size;
+  }
+
+  // With a pack buffer bound the pointer is an offset in it
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  buffer.width = width;
+  buffer.height = height;
+  buffer.generation = generation;
+  current_ = (current_ + 1) % CAPTURE_PBOS;
+}
+
+// Oldest buffer first, stops at the first one the GPU has not reached
+void FrameCapture::poll()
+{
+  for (u32 i = 0; i < CAPTURE_PBOS; i++)
+  {
+    Buffer &buffer = buffers_[(current_ + i) % CAPTURE_PBOS];
+    if (!buffer.fence)
+      continue;
+
+    if (glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+      break;
+
+    glDeleteSync(buffer.fence);
+    buffer.fence = nullptr;
+
+    // The consumer holds every frame
+    CapturedFrame *frame = spare_;
+    spare_ = nullptr;
+    if (!frame && !free_.pop(frame))
+    {
+      dropped_++;
+      continue;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.pbo);
+    const u_byte *pixels = static_cast<const u_byte *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(buffer.size), GL_MAP_READ_BIT));
+    if (pixels)
+    {
+      frame->pixels.assign(pixels, pixels + buffer.size);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (!pixels)
+    {
+      spare_ = frame;
+      dropped_++;
+      continue;
+    }
+
+    frame->width = buffer.width;
+    frame->height = buffer.height;
+    frame->generation = buffer.generation;
+
+    // Never full, the pool is the size of the queue
+    ready_.push(frame);
+    captured_++;
+  }
+}
+
+CapturedFrame *FrameCapture::pop()
+{
+  CapturedFrame *frame = nullptr;
+  ready_.pop(frame);
+  return frame;
+}
+
+void FrameCapture::recycle(CapturedFrame *frame) { free_.push(frame); }
+
+u64 FrameCapture::captured() { return captured_; }
+
+u64 FrameCapture::dropped() { return dropped_; }
+
+void FrameCapture::release()
+{
+  for (Buffer &buffer : buffers_)
+  {
+    if (buffer.fence)
+      glDeleteSync(buffer.fence);
+    if (buffer.pbo)
+      glDeleteBuffers(1, &buffer.pbo);
+    buffer = Buffer{};
+  }
+
+  current_ = 0;
+}
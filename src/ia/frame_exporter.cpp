@@ -0,0 +1,126 @@
+#include "ia/frame_exporter.h"
+#include <filesystem>
+
+// The engine only builds the stb reader, the writer is kept out of -Werror
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wconversion"
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_STATIC
+#include <stb/stb_image_write.h>
+#pragma GCC diagnostic pop
+
+FrameExporter::FrameExporter() : capture_(nullptr), format_(Format::PNG), written_(0), failed_(0) {}
+
+FrameExporter::~FrameExporter() { stop(); }
+
+boolean FrameExporter::start(FrameCapture *capture, const std::string &directory, Format format)
+{
+  stop();
+
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  if (error)
+  {
+    fprintf(stderr, "Can not create %s: %s\n", directory.c_str(), error.message().c_str());
+    return false;
+  }
+
+  capture_ = capture;
+  directory_ = directory;
+  format_ = format;
+  written_ = 0;
+  failed_ = 0;
+
+  return true;
+}
+
+void FrameExporter::stop()
+{
+  if (!capture_)
+    return;
+
+  // The frames already in the capture queue are written too
+  for (pump(); !jobs_.empty(); pump())
+    finish(true);
+
+  capture_ = nullptr;
+}
+
+boolean FrameExporter::running() { return capture_ != nullptr; }
+
+void FrameExporter::pump()
+{
+  if (!capture_)
+    return;
+
+  finish(false);
+
+  while (!saturated())
+  {
+    CapturedFrame *frame = capture_->pop();
+    if (!frame)
+      break;
+
+    // Names sort by generation
+    byte name[64];
+    if (format_ == Format::PNG)
+      snprintf(name, sizeof(name), "%010llu.png", static_cast<unsigned long long>(frame->generation));
+    else
+      snprintf(name, sizeof(name), "%010llu_%ux%u.r8", static_cast<unsigned long long>(frame->generation), frame->width, frame->height);
+
+    // Half the cores can be no TaskManager worker at all
+    if (std::thread::hardware_concurrency() / 2 == 0)
+    {
+      std::promise<boolean> encoded;
+      encoded.set_value(Encode(frame, directory_ + "/" + name, format_));
+      jobs_.push_back(Job{frame, encoded.get_future()});
+      continue;
+    }
+
+    jobs_.push_back(Job{frame, TM->enqueue(&FrameExporter::Encode, frame, directory_ + "/" + name, format_)});
+  }
+}
+
+boolean FrameExporter::saturated() { return jobs_.size() >= EXPORT_FRAMES_IN_FLIGHT; }
+
+u64 FrameExporter::written() { return written_; }
+
+u64 FrameExporter::failed() { return failed_; }
+
+// Frames go back to the capture from this thread, its free queue only has
+// one producer
+void FrameExporter::finish(boolean wait)
+{
+  for (auto job = jobs_.begin(); job != jobs_.end();)
+  {
+    if (!wait && job->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+      job++;
+      continue;
+    }
+
+    if (job->result.get())
+      written_++;
+    else
+      failed_++;
+
+    capture_->recycle(job->frame);
+    job = jobs_.erase(job);
+  }
+}
+
+// Worker thread, only the alpha of the frame is the state
+boolean FrameExporter::Encode(const CapturedFrame *frame, const std::string &path, Format format)
+{
+  std::vector<u_byte> state(static_cast<size_t>(frame->width) * frame->height);
+  for (size_t i = 0; i < state.size(); i++)
+    state[i] = frame->pixels[i * 4 + 3];
+
+  if (format == Format::PNG)
+    return stbi_write_png(path.c_str(), static_cast<s32>(frame->width), static_cast<s32>(frame->height), 1, state.data(), static_cast<s32>(frame->width)) != 0;
+
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char *>(state.data()), static_cast<std::streamsize>(state.size()));
+  return static_cast<boolean>(file);
+}
@@ -1,6 +1,8 @@
 #include "ia/gpu_helper.h"
+#include "ia/defines.h"
+#include <filesystem>
 
-GLuint GPUHelper::CreateTexture(u32 width, u32 height, u_byte *data)
+GLuint GPUHelper::CreateTexture(u32 width, u32 height)
 {
   GLuint id;
   // Generate texture
@@ -11,47 +13,233 @@ GLuint GPUHelper::CreateTexture(u32 width, u32 height, u_byte *data)
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
 
   // Unbind texture
   glBindTexture(GL_TEXTURE_2D, 0);
   return id;
 }
 
-GLuint GPUHelper::CompileShader(u32 shader_type, const char *source, const char *name)
+// FNV-1a, enough to tell sources and drivers apart
+static u64 HashString(u64 hash, const char *str, size_t size)
 {
-  GLint success;
-  GLuint shader = glCreateShader(shader_type);
+  for (size_t i = 0; i < size; i++)
+  {
+    hash ^= static_cast<u_byte>(str[i]);
+    hash *= 0x100000001b3ull;
+  }
+
+  return hash;
+}
+
+std::string GPUHelper::ProgramCachePath(const std::string &source)
+{
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if (formats <= 0)
+    return std::string();
+
+  u64 hash = 0xcbf29ce484222325ull;
+  hash = HashString(hash, source.data(), source.size());
+
+  const GLenum driver[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+  for (GLenum info : driver)
+  {
+    const char *str = reinterpret_cast<const char *>(glGetString(info));
+    if (str)
+      hash = HashString(hash, str, std::strlen(str));
+  }
+
+  char file[32];
+  snprintf(file, sizeof(file), "%016llx.bin", static_cast<unsigned long long>(hash));
+  return std::string(SHADER_CACHE_DIR) + file;
+}
+
+GLuint GPUHelper::CreateComputeProgram(const std::string &source, const char *name)
+{
+  std::string cache_path;
+  GLuint program = StartComputeProgram(source, cache_path);
 
-  glShaderSource(shader, 1, &source, nullptr);
+  return FinishComputeProgram(program, cache_path, name);
+}
 
+static boolean ParallelCompile()
+{
+  return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+}
+
+GLuint GPUHelper::StartComputeProgram(const std::string &source, std::string &cache_path)
+{
+  cache_path = ProgramCachePath(source);
+  if (!cache_path.empty())
+  {
+    GLuint program = LoadProgramBinary(cache_path);
+    if (program)
+    {
+      cache_path.clear();
+      return program;
+    }
+  }
+
+  // Let the driver pick its own compiler thread count
+  static boolean threads = false;
+  if (!threads && ParallelCompile())
+  {
+    if (GLEW_KHR_parallel_shader_compile)
+      glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    else
+      glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    threads = true;
+  }
+
+  // No status query here, any of them would wait for the compiler
+  const char *str = source.c_str();
+  GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+  glShaderSource(shader, 1, &str, nullptr);
   glCompileShader(shader);
 
-  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+  GLuint program = glCreateProgram();
+  glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glAttachShader(program, shader);
+  glLinkProgram(program);
+
+  // Freed with the program or when detached by Finish, deleting a program
+  // still compiling leaks nothing
+  glDeleteShader(shader);
+
+  return program;
+}
+
+boolean GPUHelper::ComputeProgramDone(u32 program)
+{
+  if (!ParallelCompile())
+    return true;
+
+  GLint done = GL_FALSE;
+  glGetProgramiv(program, GL_COMPLETION_STATUS_ARB, &done);
+  return done == GL_TRUE;
+}
+
+GLuint GPUHelper::FinishComputeProgram(u32 program, const std::string &cache_path, const char *name)
+{
+  GLint success;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+  // The program keeps the binary, detaching frees the shader
+  GLuint shaders[1] = {0};
+  GLsizei count = 0;
+  glGetAttachedShaders(program, 1, &count, shaders);
+
+  if (!success)
+  {
+    GLchar info_log[512] = "";
+    GLint compiled = GL_TRUE;
+    if (count > 0)
+      glGetShaderiv(shaders[0], GL_COMPILE_STATUS, &compiled);
+
+    if (!compiled)
+    {
+      glGetShaderInfoLog(shaders[0], 512, NULL, info_log);
+      fprintf(stderr, "Error compiling %s:\n%s\n", name, info_log);
+    }
+    else
+    {
+      glGetProgramInfoLog(program, 512, NULL, info_log);
+      fprintf(stderr, "Error linking %s:\n%s\n", name, info_log);
+    }
+  }
+
+  if (count > 0)
+    glDetachShader(program, shaders[0]);
+
   if (!success)
   {
-    GLchar info_log[512];
-    glGetShaderInfoLog(shader, 512, NULL, info_log);
-    fprintf(stderr, "Error compiling %s:\n%s\n", name, info_log);
-    std::exit(-1);
+    glDeleteProgram(program);
+    return 0;
   }
-  return shader;
+
+  if (!cache_path.empty())
+    SaveProgramBinary(program, cache_path);
+
+  return program;
 }
 
-GLuint GPUHelper::CreateProgram(u32 compute_shader, const char *name)
+// Every settled variant adds a binary, the least recently used ones go
+static void TrimProgramCache()
 {
-  GLint success;
+  std::error_code error;
+  std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> files;
+  for (const auto &entry : std::filesystem::directory_iterator(SHADER_CACHE_DIR, error))
+  {
+    if (entry.path().extension() == ".bin")
+      files.emplace_back(entry.last_write_time(error), entry.path());
+  }
+
+  if (files.size() <= MAX_SHADER_CACHE_FILES)
+    return;
+
+  std::sort(files.begin(), files.end());
+  for (size_t i = 0; i + MAX_SHADER_CACHE_FILES < files.size(); i++)
+    std::filesystem::remove(files[i].second, error);
+}
+
+GLuint GPUHelper::LoadProgramBinary(const std::string &path)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return 0;
+
+  GLenum format = 0;
+  if (!file.read(reinterpret_cast<char *>(&format), sizeof(format)))
+    return 0;
+
+  std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  file.close();
+  if (binary.empty())
+    return 0;
+
   GLuint program = glCreateProgram();
-  glAttachShader(program, compute_shader);
-  glLinkProgram(program);
+  glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
 
+  GLint success;
   glGetProgramiv(program, GL_LINK_STATUS, &success);
   if (!success)
   {
-    GLchar info_log[512];
-    glGetProgramInfoLog(program, 512, NULL, info_log);
-    fprintf(stderr, "Error linking %s:\n%s\n", name, info_log);
-    std::exit(-1);
+    glDeleteProgram(program);
+    return 0;
   }
+
+  // Used now, TrimProgramCache keeps it
+  std::error_code error;
+  std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
   return program;
-}
\ No newline at end of file
+}
+
+void GPUHelper::SaveProgramBinary(GLuint program, const std::string &path)
+{
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+
+  GLenum format = 0;
+  std::vector<char> binary(static_cast<size_t>(length));
+  glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+  std::error_code error;
+  std::filesystem::create_directories(SHADER_CACHE_DIR, error);
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file)
+  {
+    fprintf(stderr, "Can not write the shader cache %s\n", path.c_str());
+    return;
+  }
+
+  file.write(reinterpret_cast<const char *>(&format), sizeof(format));
+  file.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+  file.close();
+
+  TrimProgramCache();
+}
@@ -0,0 +1,121 @@
+#include "ia/gpu_stats.h"
+
+GPUStats::GPUStats() : frames_{}, current_(0), last_{}, ready_(false) {}
+
+GPUStats::~GPUStats() {}
+
+std::string GPUStats::Source()
+{
+  // #extension has to come before the first declaration of defines. Without
+  // the extensions the shader falls back to a shared memory tree
+  std::string source = defines;
+  source.insert(source.find('\n', source.find("#version")) + 1,
+                "#extension GL_KHR_shader_subgroup_basic : enable\n"
+                "#extension GL_KHR_shader_subgroup_arithmetic : enable\n");
+
+  return source + LoadSourceFromFile(SHADER("ia/stats/stats_cs.glsl"));
+}
+
+boolean GPUStats::record(u32 program, u32 texture, u32 width, u32 height, u64 generation)
+{
+  if (!frames_[0].buffer)
+  {
+    for (Frame &frame : frames_)
+    {
+      glGenBuffers(1, &frame.buffer);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, frame.buffer);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, STATS_VALUES * sizeof(u32), nullptr, GL_STREAM_READ);
+      glGenQueries(1, &frame.query);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  }
+
+  collect();
+
+  Frame &frame = frames_[current_];
+  if (frame.fence)
+    return false;
+
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, frame.buffer);
+  glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+  glUseProgram(program);
+
+  glBindImageTexture(PREV_IMG_BIND, texture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, STATS_BIND, frame.buffer);
+
+  glBeginQuery(GL_TIME_ELAPSED, frame.query);
+  glDispatchCompute((width + X_THREADS - 1) / X_THREADS, (height + Y_THREADS * STATS_ROWS - 1) / (Y_THREADS * STATS_ROWS), 1);
+  glEndQuery(GL_TIME_ELAPSED);
+
+  glUseProgram(0);
+
+  // Read with glGetBufferSubData once the fence signals
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+  frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  frame.generation = generation;
+  current_ = (current_ + 1) % STATS_FRAMES;
+  return true;
+}
+
+// Oldest frame first, stops at the first one the GPU has not reached
+void GPUStats::collect()
+{
+  for (u32 i = 0; i < STATS_FRAMES; i++)
+  {
+    Frame &frame = frames_[(current_ + i) % STATS_FRAMES];
+    if (!frame.fence)
+      continue;
+
+    if (glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+      break;
+
+    glDeleteSync(frame.fence);
+    frame.fence = nullptr;
+
+    u32 values[STATS_VALUES];
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, frame.buffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(values), values);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(frame.query, GL_QUERY_RESULT, &elapsed);
+
+    auto sum = [&](u32 index) { return static_cast<u64>(values[index]) | (static_cast<u64>(values[index + 1]) << 32); };
+    u64 mass = sum(STATS_MASS);
+
+    last_.generation = frame.generation;
+    last_.population = values[STATS_POPULATION];
+    last_.mass = static_cast<f64>(mass) / 255.0;
+    last_.centroid_x = mass ? static_cast<f64>(sum(STATS_MOMENT_X)) / static_cast<f64>(mass) : 0.0;
+    last_.centroid_y = mass ? static_cast<f64>(sum(STATS_MOMENT_Y)) / static_cast<f64>(mass) : 0.0;
+    std::copy(values + STATS_HISTOGRAM, values + STATS_HISTOGRAM + STATS_BINS, last_.histogram);
+    last_.time = static_cast<u64>(elapsed);
+    ready_ = true;
+  }
+}
+
+boolean GPUStats::ready() { return ready_; }
+
+const GPUStats::Result &GPUStats::last() { return last_; }
+
+void GPUStats::release()
+{
+  if (!frames_[0].buffer)
+    return;
+
+  for (Frame &frame : frames_)
+  {
+    if (frame.fence)
+      glDeleteSync(frame.fence);
+    glDeleteBuffers(1, &frame.buffer);
+    glDeleteQueries(1, &frame.query);
+    frame = Frame{};
+  }
+
+  current_ = 0;
+  last_ = Result{};
+  ready_ = false;
+}
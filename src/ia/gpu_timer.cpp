@@ -0,0 +1,121 @@
+#include "ia/gpu_timer.h"
+
+GPUTimer::GPUTimer() : frames_{}, current_(0), recording_(false), open_(false) {}
+
+GPUTimer::~GPUTimer() {}
+
+void GPUTimer::beginFrame()
+{
+  if (!frames_[0].queries[0])
+  {
+    for (Frame &frame : frames_)
+      glGenQueries(MAX_GPU_TIMER_QUERIES, frame.queries);
+  }
+
+  collect();
+
+  // A frame still pending here is GPU_TIMER_FRAMES updates behind, its
+  // queries are reused and its times lost
+  current_ = (current_ + 1) % GPU_TIMER_FRAMES;
+  frames_[current_].count = 0;
+  frames_[current_].pending = false;
+
+  recording_ = true;
+}
+
+void GPUTimer::endFrame()
+{
+  if (open_)
+    end();
+
+  frames_[current_].pending = frames_[current_].count > 0;
+  recording_ = false;
+}
+
+void GPUTimer::begin(const char *pass)
+{
+  Frame &frame = frames_[current_];
+  if (!recording_ || open_ || frame.count >= MAX_GPU_TIMER_QUERIES)
+    return;
+
+  frame.names[frame.count] = pass;
+  glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.count]);
+  open_ = true;
+}
+
+void GPUTimer::end()
+{
+  if (!open_)
+    return;
+
+  glEndQuery(GL_TIME_ELAPSED);
+  frames_[current_].count++;
+  open_ = false;
+}
+
+// Oldest frame first, stops at the first one the GPU has not reached
+void GPUTimer::collect()
+{
+  for (u32 i = 1; i <= GPU_TIMER_FRAMES; i++)
+  {
+    Frame &frame = frames_[(current_ + i) % GPU_TIMER_FRAMES];
+    if (!frame.pending)
+      continue;
+
+    GLint available = 0;
+    glGetQueryObjectiv(frame.queries[frame.count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+      break;
+
+    names_.clear();
+    times_.clear();
+    for (u32 query = 0; query < frame.count; query++)
+    {
+      GLuint64 elapsed = 0;
+      glGetQueryObjectui64v(frame.queries[query], GL_QUERY_RESULT, &elapsed);
+
+      auto name = std::find_if(names_.begin(), names_.end(), [&](const char *known) { return !std::strcmp(known, frame.names[query]); });
+      if (name == names_.end())
+      {
+        names_.push_back(frame.names[query]);
+        times_.push_back(static_cast<u64>(elapsed));
+      }
+      else
+        times_[static_cast<size_t>(name - names_.begin())] += static_cast<u64>(elapsed);
+    }
+
+    frame.pending = false;
+  }
+}
+
+size_t GPUTimer::passes() { return times_.size(); }
+
+const char *GPUTimer::passName(size_t pass) { return names_[pass]; }
+
+u64 GPUTimer::passTime(size_t pass) { return times_[pass]; }
+
+u64 GPUTimer::total()
+{
+  u64 total = 0;
+  for (u64 time : times_)
+    total += time;
+
+  return total;
+}
+
+void GPUTimer::release()
+{
+  if (!frames_[0].queries[0])
+    return;
+
+  for (Frame &frame : frames_)
+  {
+    glDeleteQueries(MAX_GPU_TIMER_QUERIES, frame.queries);
+    frame = Frame{};
+  }
+
+  names_.clear();
+  times_.clear();
+  recording_ = false;
+  open_ = false;
+}
@@ -0,0 +1,409 @@
+#include "ia/hashlife.h"
+
+#define HASHLIFE_BLOCK_NODES (1 << 16)
+#define HASHLIFE_MIN_BUCKETS (1 << 16)
+#define HASHLIFE_MIN_LEVEL 3u
+
+static size_t HashNode(const void *nw, const void *ne, const void *sw, const void *se)
+{
+  u64 h = reinterpret_cast<uintptr_t>(nw);
+  h = h * 0x9E3779B97F4A7C15ull + reinterpret_cast<uintptr_t>(ne);
+  h = h * 0x9E3779B97F4A7C15ull + reinterpret_cast<uintptr_t>(sw);
+  h = h * 0x9E3779B97F4A7C15ull + reinterpret_cast<uintptr_t>(se);
+  h ^= h >> 29;
+
+  return static_cast<size_t>(h);
+}
+
+Hashlife::Hashlife()
+    : free_list_(nullptr), count_(0),
+      dead_{nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, 0, 0},
+      alive_{nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 1, 0, 0},
+      root_(nullptr), origin_x_(0), origin_y_(0),
+      step_log2_(0), max_bytes_(static_cast<size_t>(512) << 20)
+{
+  clear();
+}
+
+Hashlife::~Hashlife() {}
+
+void Hashlife::clear()
+{
+  blocks_.clear();
+  free_list_ = nullptr;
+
+  buckets_.assign(HASHLIFE_MIN_BUCKETS, nullptr);
+  count_ = 0;
+
+  empties_.clear();
+  root_ = nullptr;
+  origin_x_ = 0;
+  origin_y_ = 0;
+}
+
+// Nodes
+///////////////////////////////////////////////////////////////////////////////
+Hashlife::Node *Hashlife::allocate()
+{
+  if (!free_list_)
+  {
+    blocks_.push_back(std::make_unique<Node[]>(HASHLIFE_BLOCK_NODES));
+    Node *block = blocks_.back().get();
+
+    for (u32 i = 0; i < HASHLIFE_BLOCK_NODES; i++)
+    {
+      block[i].next_ = free_list_;
+      free_list_ = &block[i];
+    }
+  }
+
+  Node *node = free_list_;
+  free_list_ = node->next_;
+  return node;
+}
+
+Hashlife::Node *Hashlife::join(Node *nw, Node *ne, Node *sw, Node *se)
+{
+  size_t index = HashNode(nw, ne, sw, se) & (buckets_.size() - 1);
+
+  for (Node *node = buckets_[index]; node; node = node->next_)
+    if (node->nw_ == nw && node->ne_ == ne && node->sw_ == sw && node->se_ == se)
+      return node;
+
+  Node *node = allocate();
+  node->nw_ = nw;
+  node->ne_ = ne;
+  node->sw_ = sw;
+  node->se_ = se;
+  node->result_ = nullptr;
+  node->population_ = nw->population_ + ne->population_ + sw->population_ + se->population_;
+  node->level_ = nw->level_ + 1;
+  node->marked_ = 0;
+
+  node->next_ = buckets_[index];
+  buckets_[index] = node;
+  count_++;
+
+  if (count_ > buckets_.size())
+    rehash(buckets_.size() * 2);
+
+  return node;
+}
+
+void Hashlife::rehash(size_t buckets)
+{
+  std::vector<Node *> old_buckets(buckets, nullptr);
+  std::swap(old_buckets, buckets_);
+
+  for (Node *chain : old_buckets)
+  {
+    while (chain)
+    {
+      Node *node = chain;
+      chain = chain->next_;
+
+      size_t index = HashNode(node->nw_, node->ne_, node->sw_, node->se_) & (buckets_.size() - 1);
+      node->next_ = buckets_[index];
+      buckets_[index] = node;
+    }
+  }
+}
+
+Hashlife::Node *Hashlife::empty(u32 level)
+{
+  if (level == 0)
+    return &dead_;
+
+  while (empties_.size() < level)
+  {
+    Node *child = empties_.empty() ? &dead_ : empties_.back();
+    empties_.push_back(join(child, child, child, child));
+  }
+
+  return empties_[level - 1];
+}
+
+// Same node one level up, with the old one in the middle
+Hashlife::Node *Hashlife::centre(Node *node)
+{
+  Node *border = empty(node->level_ - 1);
+
+  return join(join(border, border, border, node->nw_),
+              join(border, border, node->ne_, border),
+              join(border, node->sw_, border, border),
+              join(node->se_, border, border, border));
+}
+
+// Middle of the node, one level down
+Hashlife::Node *Hashlife::inner(Node *node)
+{
+  return join(node->nw_->se_, node->ne_->sw_, node->sw_->ne_, node->se_->nw_);
+}
+///////////////////////////////////////////////////////////////////////////////
+
+// Evolution
+///////////////////////////////////////////////////////////////////////////////
+Hashlife::Node *Hashlife::life4x4(Node *node)
+{
+  u32 cells[4][4];
+  Node *quadrants[4] = {node->nw_, node->ne_, node->sw_, node->se_};
+
+  for (u32 q = 0; q < 4; q++)
+  {
+    u32 x = (q % 2) * 2;
+    u32 y = (q / 2) * 2;
+    cells[y + 0][x + 0] = static_cast<u32>(quadrants[q]->nw_->population_);
+    cells[y + 0][x + 1] = static_cast<u32>(quadrants[q]->ne_->population_);
+    cells[y + 1][x + 0] = static_cast<u32>(quadrants[q]->sw_->population_);
+    cells[y + 1][x + 1] = static_cast<u32>(quadrants[q]->se_->population_);
+  }
+
+  Node *next[4];
+  for (u32 i = 0; i < 4; i++)
+  {
+    u32 x = 1 + (i % 2);
+    u32 y = 1 + (i / 2);
+
+    u32 alive_neighbours = 0;
+    for (u32 ny = y - 1; ny <= y + 1; ny++)
+      for (u32 nx = x - 1; nx <= x + 1; nx++)
+        alive_neighbours += cells[ny][nx];
+    alive_neighbours -= cells[y][x];
+
+    boolean alive = cells[y][x] ? (alive_neighbours == 2 || alive_neighbours == 3) : (alive_neighbours == 3);
+    next[i] = alive ? &alive_ : &dead_;
+  }
+
+  return join(next[0], next[1], next[2], next[3]);
+}
+
+// Center of the node (one level down) advanced 2^j generations, with
+// j <= level - 2. The nine overlapping subnodes are advanced first, then
+// either advanced again (full speed) or only recentered.
+Hashlife::Node *Hashlife::successor(Node *node, u32 j)
+{
+  if (node->population_ == 0)
+    return node->nw_;
+  if (node->result_)
+    return node->result_;
+
+  Node *result;
+  if (node->level_ == 2)
+  {
+    result = life4x4(node);
+  }
+  else
+  {
+    j = std::min(j, node->level_ - 2);
+
+    Node *a = node->nw_, *b = node->ne_, *c = node->sw_, *d = node->se_;
+
+    Node *c1 = successor(a, j);
+    Node *c2 = successor(join(a->ne_, b->nw_, a->se_, b->sw_), j);
+    Node *c3 = successor(b, j);
+    Node *c4 = successor(join(a->sw_, a->se_, c->nw_, c->ne_), j);
+    Node *c5 = successor(join(a->se_, b->sw_, c->ne_, d->nw_), j);
+    Node *c6 = successor(join(b->sw_, b->se_, d->nw_, d->ne_), j);
+    Node *c7 = successor(c, j);
+    Node *c8 = successor(join(c->ne_, d->nw_, c->se_, d->sw_), j);
+    Node *c9 = successor(d, j);
+
+    if (j < node->level_ - 2)
+    {
+      result = join(join(c1->se_, c2->sw_, c4->ne_, c5->nw_),
+                    join(c2->se_, c3->sw_, c5->ne_, c6->nw_),
+                    join(c4->se_, c5->sw_, c7->ne_, c8->nw_),
+                    join(c5->se_, c6->sw_, c8->ne_, c9->nw_));
+    }
+    else
+    {
+      result = join(successor(join(c1, c2, c4, c5), j),
+                    successor(join(c2, c3, c5, c6), j),
+                    successor(join(c4, c5, c7, c8), j),
+                    successor(join(c5, c6, c8, c9), j));
+    }
+  }
+
+  node->result_ = result;
+  return result;
+}
+
+void Hashlife::step()
+{
+  if (!root_)
+    return;
+
+  // Grow until the pattern sits in the inner half and the root is big enough
+  // to advance 2^k at once, then once more so nothing escapes the result
+  while (root_->level_ < step_log2_ + 2 || inner(root_)->population_ != root_->population_)
+  {
+    origin_x_ -= s64{1} << (root_->level_ - 1);
+    origin_y_ -= s64{1} << (root_->level_ - 1);
+    root_ = centre(root_);
+  }
+
+  origin_x_ -= s64{1} << (root_->level_ - 1);
+  origin_y_ -= s64{1} << (root_->level_ - 1);
+  root_ = centre(root_);
+
+  origin_x_ += s64{1} << (root_->level_ - 2);
+  origin_y_ += s64{1} << (root_->level_ - 2);
+  root_ = successor(root_, step_log2_);
+
+  // Shrink back while the border is empty
+  while (root_->level_ > HASHLIFE_MIN_LEVEL && inner(root_)->population_ == root_->population_)
+  {
+    origin_x_ += s64{1} << (root_->level_ - 2);
+    origin_y_ += s64{1} << (root_->level_ - 2);
+    root_ = inner(root_);
+  }
+
+  if (bytes() > max_bytes_)
+  {
+    collect(true);
+    if (bytes() > max_bytes_ / 2)
+      collect(false);
+  }
+}
+
+void Hashlife::setStepLog2(u32 k)
+{
+  k = std::min(k, 60u);
+  if (k == step_log2_)
+    return;
+
+  // Memoized results depend on the step
+  clearResults();
+  step_log2_ = k;
+}
+
+u32 Hashlife::stepLog2() { return step_log2_; }
+///////////////////////////////////////////////////////////////////////////////
+
+// Garbage collection
+///////////////////////////////////////////////////////////////////////////////
+void Hashlife::setMaxBytes(size_t bytes) { max_bytes_ = bytes; }
+
+void Hashlife::mark(Node *node, boolean keep_results)
+{
+  if (!node || node->level_ == 0 || node->marked_)
+    return;
+
+  node->marked_ = 1;
+  mark(node->nw_, keep_results);
+  mark(node->ne_, keep_results);
+  mark(node->sw_, keep_results);
+  mark(node->se_, keep_results);
+
+  if (keep_results)
+    mark(node->result_, keep_results);
+}
+
+void Hashlife::collect(boolean keep_results)
+{
+  mark(root_, keep_results);
+  for (Node *node : empties_)
+    mark(node, keep_results);
+
+  for (Node *&chain : buckets_)
+  {
+    Node **link = &chain;
+    while (*link)
+    {
+      Node *node = *link;
+      if (node->marked_)
+      {
+        node->marked_ = 0;
+        if (!keep_results)
+          node->result_ = nullptr;
+        link = &node->next_;
+      }
+      else
+      {
+        *link = node->next_;
+        node->next_ = free_list_;
+        free_list_ = node;
+        count_--;
+      }
+    }
+  }
+}
+
+void Hashlife::clearResults()
+{
+  for (Node *chain : buckets_)
+    for (Node *node = chain; node; node = node->next_)
+      node->result_ = nullptr;
+}
+///////////////////////////////////////////////////////////////////////////////
+
+// Grid
+///////////////////////////////////////////////////////////////////////////////
+Hashlife::Node *Hashlife::build(const u_byte *rgba, u32 width, u32 height, s64 x, s64 y, u32 level)
+{
+  if (x >= static_cast<s64>(width) || y >= static_cast<s64>(height))
+    return empty(level);
+
+  if (level == 0)
+    return (rgba[(static_cast<size_t>(y) * width + static_cast<size_t>(x)) * 4 + 3] > 127) ? &alive_ : &dead_;
+
+  s64 half = s64{1} << (level - 1);
+  return join(build(rgba, width, height, x, y, level - 1),
+              build(rgba, width, height, x + half, y, level - 1),
+              build(rgba, width, height, x, y + half, level - 1),
+              build(rgba, width, height, x + half, y + half, level - 1));
+}
+
+void Hashlife::load(const u_byte *rgba, u32 width, u32 height)
+{
+  clear();
+
+  u32 level = HASHLIFE_MIN_LEVEL;
+  while ((u64{1} << level) < std::max(width, height))
+    level++;
+
+  root_ = build(rgba, width, height, 0, 0, level);
+}
+
+void Hashlife::fill(Node *node, u_byte *rgba, u32 width, u32 height, s64 x, s64 y)
+{
+  if (node->population_ == 0)
+    return;
+
+  s64 size = s64{1} << node->level_;
+  if (x >= static_cast<s64>(width) || y >= static_cast<s64>(height) || x + size <= 0 || y + size <= 0)
+    return;
+
+  if (node->level_ == 0)
+  {
+    rgba[(static_cast<size_t>(y) * width + static_cast<size_t>(x)) * 4 + 3] = 255;
+    return;
+  }
+
+  s64 half = size / 2;
+  fill(node->nw_, rgba, width, height, x, y);
+  fill(node->ne_, rgba, width, height, x + half, y);
+  fill(node->sw_, rgba, width, height, x, y + half);
+  fill(node->se_, rgba, width, height, x + half, y + half);
+}
+
+void Hashlife::store(u_byte *rgba, u32 width, u32 height)
+{
+  for (size_t i = 0; i < static_cast<size_t>(width) * height * 4; i += 4)
+  {
+    rgba[i + 0] = 255;
+    rgba[i + 1] = 255;
+    rgba[i + 2] = 255;
+    rgba[i + 3] = 0;
+  }
+
+  if (root_)
+    fill(root_, rgba, width, height, origin_x_, origin_y_);
+}
+///////////////////////////////////////////////////////////////////////////////
+
+u64 Hashlife::population() { return root_ ? root_->population_ : 0; }
+
+size_t Hashlife::nodes() { return count_; }
+
+size_t Hashlife::bytes() { return count_ * sizeof(Node) + buckets_.size() * sizeof(Node *); }
@@ -2,165 +2,271 @@
 #include "ia/gpu_helper.h"
 #include "ia/defines.h"
 
-Lenia::Lenia() {}
+// Default Lenia config
+Lenia::Lenia()
+    : Automaton("Lenia", Seed::Continuous),
+      radius_(15.0f), dt_(5.0f), mu_(0.14f), sigma_(0.014f), rho_(0.5f), omega_(0.15f),
+      compute_program_(0), specialize_(true), specialized_(false), fft_rows_program_(0), fft_columns_program_(0), fft_growth_program_(0),
+      spectrum_ssbo_(0), kernel_ssbo_(0), backend_(Backend::Texture), dirty_(false) {}
 
-void Lenia::init(Math::Vec2 win)
+Lenia::~Lenia() {}
+
+void Lenia::setBackend(Backend backend)
 {
-  loops_ = 0;
-  width_ = static_cast<u32>(win.x);
-  height_ = static_cast<u32>(win.y);
+  if (backend == backend_)
+    return;
 
-  u_byte *data = reinterpret_cast<u_byte *>(std::calloc(width_ * height_ * 4, sizeof(u_byte)));
+  if (backend == Backend::GPUFFT && !initGPUFFT())
+    return;
 
-  if (!data)
-  {
-    width_ = 0;
-    height_ = 0;
+  // Continue from the state the texture shows
+  present();
 
-    return;
+  backend_ = backend;
+  radius_ = std::min(radius_, maxRadius());
+
+  uploaded();
+}
+
+Lenia::Backend Lenia::backend() { return backend_; }
+
+f32 Lenia::maxRadius() { return (backend_ == Backend::Texture) ? 25.0f : 100.0f; }
+
+boolean Lenia::initGPUFFT()
+{
+  // Radix 2 passes with a whole row or column in shared memory
+  boolean power_of_two = (width_ & (width_ - 1)) == 0 && (height_ & (height_ - 1)) == 0;
+  if (!power_of_two || width_ > MAX_FFT_SIZE || height_ > MAX_FFT_SIZE)
+  {
+    fprintf(stderr, "Lenia GPU FFT needs power of two sizes up to %d, grid is %ux%u\n", MAX_FFT_SIZE, width_, height_);
+    return false;
   }
 
-  current_data_id_ = GPUHelper::CreateTexture(width_, height_, data);
-  prev_data_id_ = GPUHelper::CreateTexture(width_, height_, data);
+  if (spectrum_ssbo_)
+    return true;
 
-  DESTROY(data);
+  // The kernel spectrum is built by LeniaFFT and uploaded when it changes
+  fft_.init(width_, height_);
 
-  compileShaders();
+  // Spectrum buffers
+  /////////////////////////////////////////////////////////////////////////////
+  GLsizeiptr size = static_cast<GLsizeiptr>((width_ / 2 + 1) * height_ * sizeof(LeniaFFT::Complex));
 
-  // Default Lenia config
-  radius_ = 15.0f;
-  dt_ = 5.0f;
-  mu_ = 0.14f;
-  sigma_ = 0.014f;
-  rho_ = 0.5f;
-  omega_ = 0.15f;
+  glGenBuffers(1, &spectrum_ssbo_);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, spectrum_ssbo_);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
 
-  glUseProgram(compute_program_);
+  glGenBuffers(1, &kernel_ssbo_);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernel_ssbo_);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
 
-  reset();
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  /////////////////////////////////////////////////////////////////////////////
+
+  return true;
 }
 
-Lenia::~Lenia() {}
+void Lenia::initResources()
+{
+  // The grid may not suit the GPU FFT, the seed that follows starts the
+  // texture backend in that case
+  if (backend_ == Backend::GPUFFT && !initGPUFFT())
+    backend_ = Backend::Texture;
+}
 
-void Lenia::swap()
+void Lenia::releaseResources()
 {
-  std::swap(current_data_id_, prev_data_id_);
+  tables_.release();
+
+  if (!spectrum_ssbo_)
+    return;
+
+  glDeleteBuffers(1, &spectrum_ssbo_);
+  glDeleteBuffers(1, &kernel_ssbo_);
+  spectrum_ssbo_ = 0;
+  kernel_ssbo_ = 0;
 }
 
-void Lenia::update()
+size_t Lenia::resourceBytes()
 {
-  update_timer_.startTime();
-  loops_++;
+  size_t spectrum = static_cast<size_t>(width_ / 2 + 1) * height_ * sizeof(LeniaFFT::Complex);
+  return tables_.bytes() + (spectrum_ssbo_ ? spectrum * 2 : 0);
+}
 
-  swap();
-  
-  GLenum error = GL_NO_ERROR;
+void Lenia::uploadFFTUniforms(u32 program)
+{
+  glUniform1i(glGetUniformLocation(program, "u_width"), static_cast<s32>(width_));
+  glUniform1i(glGetUniformLocation(program, "u_height"), static_cast<s32>(height_));
+  glUniform1i(glGetUniformLocation(program, "u_half"), static_cast<s32>(width_ / 2 + 1));
+}
+
+void Lenia::step()
+{
+  if (backend_ == Backend::CPUFFT)
+  {
+    fft_.setKernel(radius_, rho_, omega_);
+    fft_.step(dt_, mu_, sigma_);
+    dirty_ = true;
+    return;
+  }
+
+  if (backend_ == Backend::GPUFFT)
+  {
+    if (fft_.setKernel(radius_, rho_, omega_))
+    {
+      const std::vector<LeniaFFT::Complex> &kernel = fft_.kernel();
+
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernel_ssbo_);
+      glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(kernel.size() * sizeof(LeniaFFT::Complex)), kernel.data());
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPECTRUM_BIND, spectrum_ssbo_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, KERNEL_BIND, kernel_ssbo_);
+    bindImages();
+
+    u32 pairs = (height_ + 1) / 2;
+
+    glUseProgram(fft_rows_program_);
+    uploadFFTUniforms(fft_rows_program_);
+    gpu_timer_.begin("FFT rows");
+    dispatch(pairs, 1);
+    gpu_timer_.end();
+
+    glUseProgram(fft_columns_program_);
+    uploadFFTUniforms(fft_columns_program_);
+    gpu_timer_.begin("FFT columns");
+    dispatch(width_ / 2 + 1, 1);
+    gpu_timer_.end();
+
+    glUseProgram(fft_growth_program_);
+    uploadFFTUniforms(fft_growth_program_);
+    glUniform1f(glGetUniformLocation(fft_growth_program_, "u_dt"), dt_);
+    glUniform1f(glGetUniformLocation(fft_growth_program_, "u_mu"), mu_);
+    glUniform1f(glGetUniformLocation(fft_growth_program_, "u_sigma"), sigma_);
+    gpu_timer_.begin("Growth and inverse FFT");
+    dispatch(pairs, 1);
+    gpu_timer_.end();
+
+    glUseProgram(0);
+    return;
+  }
 
   // GPU Automata
   /////////////////////////////////////////////////////////////////////////////
-  glUseProgram(compute_program_);
+  tables_.update(radius_, rho_, omega_, mu_, sigma_);
+  tables_.bind();
 
-  glBindImageTexture(CURR_IMG_BIND, current_data_id_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
-  glBindImageTexture(PREV_IMG_BIND, prev_data_id_, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+  // The generic program runs until the variant for these weights is ready
+  u32 program = specialize_ ? variants_.get(tables_.variantKey(), [this] { return tables_.variantDefines(); }) : 0;
+  specialized_ = program != 0;
+  if (!program)
+    program = compute_program_;
 
-  glUniform1f(glGetUniformLocation(compute_program_, "u_radius"), radius_);
-  glUniform1f(glGetUniformLocation(compute_program_, "u_dt"), dt_);
-  glUniform1f(glGetUniformLocation(compute_program_, "u_mu"), mu_);
-  glUniform1f(glGetUniformLocation(compute_program_, "u_sigma"), sigma_);
-  glUniform1f(glGetUniformLocation(compute_program_, "u_rho"), rho_);
-  glUniform1f(glGetUniformLocation(compute_program_, "u_omega"), omega_);
+  glUseProgram(program);
 
-  // Dispatch Compute Shader with appropriate workgroup sizes
-  glDispatchCompute(width_ / X_THREADS, height_ / Y_THREADS, 1);
-  error = glGetError();
-  if (error != GL_NO_ERROR)
-    fprintf(stderr, "Compute Shader Dispatch Error: %d\n", error);
+  bindImages();
 
-  glMemoryBarrier(GL_ALL_BARRIER_BITS);
+  glUniform1f(glGetUniformLocation(program, "u_radius"), radius_);
+  glUniform1f(glGetUniformLocation(program, "u_dt"), dt_);
+
+  // Dispatch Compute Shader with appropriate workgroup sizes
+  gpu_timer_.begin("Update");
+  dispatchCells(width_, height_);
+  gpu_timer_.end();
 
   glUseProgram(0);
   /////////////////////////////////////////////////////////////////////////////
-
-  glFinish();
-  update_timer_.stopTime();
 }
 
-void Lenia::imgui()
+// The state is seeded on the GPU, the CPU FFT reads it back
+void Lenia::uploaded()
 {
-  ImGui::Begin("GPU Automata");
+  if (backend_ == Backend::CPUFFT)
+  {
+    staging_.resize(static_cast<size_t>(width_) * height_ * 4);
 
-  ImGui::Text("Type - Lenia");
-  ImGui::Text("Update time: %ld mcs", update_timer_.getElapsedTime(TimeCont::Precision::microseconds));
-  ImGui::Text("Generation: %d", loops_);
+    glBindTexture(GL_TEXTURE_2D, current_data_id_);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, staging_.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-  ImGui::SliderFloat("Radius", &radius_, 10.0f, 25.0f);
-  ImGui::SliderFloat("Delta Time", &dt_, 5.0f, 15.0f);
-  ImGui::SliderFloat("Mu", &mu_, 0.14f, 0.7f);
-  ImGui::SliderFloat("Sigma", &sigma_, 0.014f, 0.07f);
-  ImGui::SliderFloat("Rho", &rho_, 0.025f, 0.075f);
-  ImGui::SliderFloat("Omega", &omega_, 0.05f, 0.025f);
+    fft_.init(width_, height_);
+    fft_.load(staging_.data());
+  }
 
-  ImGui::End();
+  dirty_ = false;
 }
 
-void Lenia::reset()
+void Lenia::present()
 {
-  loops_ = 0;
-  u_byte *data = reinterpret_cast<u_byte *>(std::calloc(width_ * height_ * 4, sizeof(u_byte)));
-
-  if (!data)
+  if (backend_ != Backend::CPUFFT || !dirty_)
     return;
 
-  u_byte alive = 255;
-
-  for (u32 i = 0; i < width_ * height_ * 4; i += 4)
-  {
-    data[i + 0] = alive;
-    data[i + 1] = alive;
-    data[i + 2] = alive;
-
-    data[i + 3] = static_cast<u_byte>(rand() % 255);
-  }
+  staging_.resize(static_cast<size_t>(width_) * height_ * 4);
+  fft_.store(staging_.data());
 
   glBindTexture(GL_TEXTURE_2D, current_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
-  glBindTexture(GL_TEXTURE_2D, prev_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, staging_.data());
   glBindTexture(GL_TEXTURE_2D, 0);
 
-  DESTROY(data);
+  dirty_ = false;
 }
 
-void Lenia::clean()
+void Lenia::imguiParams()
 {
-  u_byte *data = reinterpret_cast<u_byte *>(std::calloc(width_ * height_ * 4, sizeof(u_byte)));
+  const char *backends[] = {"Texture", "CPU FFT", "GPU FFT"};
+  s32 backend = static_cast<s32>(backend_);
+  if (ImGui::Combo("Backend", &backend, backends, 3))
+    setBackend(static_cast<Backend>(backend));
 
-  if (!data)
-    return;
+  if (backend_ == Backend::Texture)
+  {
+    ImGui::Checkbox("Specialized shaders", &specialize_);
+    ImGui::Text("Kernel: %s", specialized_ ? "specialized" : "generic");
+  }
 
-  glBindTexture(GL_TEXTURE_2D, current_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+  ImGui::SliderFloat("Radius", &radius_, 10.0f, maxRadius());
+  ImGui::SliderFloat("Delta Time", &dt_, 5.0f, 15.0f);
+  ImGui::SliderFloat("Mu", &mu_, 0.14f, 0.7f);
+  ImGui::SliderFloat("Sigma", &sigma_, 0.014f, 0.07f);
+  ImGui::SliderFloat("Rho", &rho_, 0.025f, 0.075f);
+  ImGui::SliderFloat("Omega", &omega_, 0.05f, 0.025f);
+}
 
-  glBindTexture(GL_TEXTURE_2D, prev_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+void Lenia::saveParams(std::vector<f32> &params) { params = {radius_, dt_, mu_, sigma_, rho_, omega_}; }
 
-  glBindTexture(GL_TEXTURE_2D, 0);
+void Lenia::loadParams(const std::vector<f32> &params)
+{
+  // The file is not trusted, a bad value keeps the current one
+  f32 *values[] = {&radius_, &dt_, &mu_, &sigma_, &rho_, &omega_};
+  for (size_t i = 0; i < std::min(params.size(), std::size(values)); i++)
+    if (std::isfinite(params[i]))
+      *values[i] = params[i];
 
-  DESTROY(data);
+  radius_ = std::clamp(radius_, 10.0f, maxRadius());
 }
 
-u32 Lenia::currentTexture() { return current_data_id_; }
-
 void Lenia::compileShaders()
 {
   // Compute shader
   /////////////////////////////////////////////////////////////////////////////
-  std::string lenia_string = defines + LoadSourceFromFile(SHADER("ia/lenia/lenia_cs.glsl"));
-  const char *lenia_cs = lenia_string.c_str();
+  std::string lenia_source = LoadSourceFromFile(SHADER("ia/lenia/lenia_tables.glsl")) +
+                             LoadSourceFromFile(SHADER("ia/lenia/lenia_cs.glsl"));
+  buildProgram(compute_program_, defines + lenia_source, "lenia program");
+  variants_.init(lenia_source, "lenia program");
+  /////////////////////////////////////////////////////////////////////////////
+
+  // FFT compute shaders
+  /////////////////////////////////////////////////////////////////////////////
+  std::string common = defines + LoadSourceFromFile(SHADER("ia/lenia/lenia_fft_common.glsl"));
+
+  std::string rows_string = common + LoadSourceFromFile(SHADER("ia/lenia/lenia_fft_rows_cs.glsl"));
+  buildProgram(fft_rows_program_, rows_string, "lenia fft rows program");
+
+  std::string columns_string = common + LoadSourceFromFile(SHADER("ia/lenia/lenia_fft_columns_cs.glsl"));
+  buildProgram(fft_columns_program_, columns_string, "lenia fft columns program");
 
-  GLuint compute_shader = GPUHelper::CompileShader(GL_COMPUTE_SHADER, lenia_cs, "lenia shader");
-  compute_program_ = GPUHelper::CreateProgram(compute_shader, "lenia program");
+  std::string growth_string = common + LoadSourceFromFile(SHADER("ia/lenia/lenia_fft_growth_cs.glsl"));
+  buildProgram(fft_growth_program_, growth_string, "lenia fft growth program");
   /////////////////////////////////////////////////////////////////////////////
 }
@@ -0,0 +1,219 @@
+#include "ia/lenia_fft.h"
+#include "ia/defines.h"
+
+LeniaFFT::LeniaFFT()
+    : width_(0), height_(0), half_(0), radius_(0.0f), rho_(0.0f), omega_(0.0f) {}
+
+LeniaFFT::~LeniaFFT() {}
+
+void LeniaFFT::init(u32 width, u32 height)
+{
+  width_ = width;
+  height_ = height;
+  half_ = width_ / 2 + 1;
+
+  rows_fft_.init(width_);
+  columns_fft_.init(height_);
+
+  state_.assign(static_cast<size_t>(width_) * height_, 0.0f);
+  spectrum_.assign(static_cast<size_t>(half_) * height_, Complex());
+
+  // Forces setKernel to rebuild it for the new size
+  kernel_.clear();
+}
+
+void LeniaFFT::parallel(u32 count, const std::function<void(u32, u32)> &task)
+{
+  u32 bands = std::min(std::thread::hardware_concurrency() / 2, count);
+  if (bands <= 1)
+  {
+    task(0, count);
+    return;
+  }
+
+  std::vector<std::future<void>> tasks;
+  u32 band_size = (count + bands - 1) / bands;
+  for (u32 begin = 0; begin < count; begin += band_size)
+    tasks.push_back(TM->enqueue(task, begin, std::min(begin + band_size, count)));
+
+  for (auto &result : tasks)
+    result.wait();
+}
+
+// Two real rows go through one complex FFT as z = a + i * b and are split
+// back with the hermitian symmetry of real signals:
+//   A[k] = (Z[k] + conj(Z[n - k])) / 2
+//   B[k] = (Z[k] - conj(Z[n - k])) / 2i
+// Only the first half_ values of each row spectrum are stored.
+void LeniaFFT::forwardRows(const f32 *src, std::vector<Complex> &spectrum, u32 begin, u32 end)
+{
+  std::vector<Complex> row(width_), scratch(width_);
+
+  for (u32 pair = begin; pair < end; pair++)
+  {
+    u32 y0 = pair * 2;
+    u32 y1 = y0 + 1;
+    const f32 *a = src + static_cast<size_t>(y0) * width_;
+    const f32 *b = (y1 < height_) ? a + width_ : nullptr;
+
+    for (u32 x = 0; x < width_; x++)
+      row[x] = Complex(a[x], b ? b[x] : 0.0f);
+
+    rows_fft_.forward(row.data(), scratch.data());
+
+    Complex *out_a = spectrum.data() + static_cast<size_t>(y0) * half_;
+    for (u32 k = 0; k < half_; k++)
+    {
+      Complex z = row[k];
+      Complex mirror = std::conj(row[(width_ - k) % width_]);
+
+      out_a[k] = (z + mirror) * 0.5f;
+      if (b)
+        out_a[half_ + k] = (z - mirror) * Complex(0.0f, -0.5f);
+    }
+  }
+}
+
+// Column FFTs over the row spectra. With convolve the column is multiplied by
+// the kernel spectrum and transformed back in the same go, while it is still
+// in cache.
+void LeniaFFT::columns(std::vector<Complex> &spectrum, u32 begin, u32 end, boolean convolve)
+{
+  std::vector<Complex> column(height_), scratch(height_);
+
+  for (u32 k = begin; k < end; k++)
+  {
+    for (u32 y = 0; y < height_; y++)
+      column[y] = spectrum[static_cast<size_t>(y) * half_ + k];
+
+    columns_fft_.forward(column.data(), scratch.data());
+
+    if (convolve)
+    {
+      for (u32 y = 0; y < height_; y++)
+        column[y] *= kernel_[static_cast<size_t>(y) * half_ + k];
+
+      columns_fft_.inverse(column.data(), scratch.data());
+    }
+
+    for (u32 y = 0; y < height_; y++)
+      spectrum[static_cast<size_t>(y) * half_ + k] = column[y];
+  }
+}
+
+// Inverse of forwardRows, the two potentials come back as the real and the
+// imaginary part, then the growth is applied as in lenia_cs.glsl
+void LeniaFFT::growthRows(u32 begin, u32 end, f32 dt, f32 mu, f32 sigma)
+{
+  std::vector<Complex> row(width_), scratch(width_);
+  const Complex i(0.0f, 1.0f);
+
+  for (u32 pair = begin; pair < end; pair++)
+  {
+    u32 y0 = pair * 2;
+    u32 y1 = y0 + 1;
+    const Complex *a = spectrum_.data() + static_cast<size_t>(y0) * half_;
+    const Complex *b = (y1 < height_) ? a + half_ : nullptr;
+
+    for (u32 k = 0; k < half_; k++)
+      row[k] = a[k] + (b ? i * b[k] : Complex());
+
+    for (u32 k = half_; k < width_; k++)
+      row[k] = std::conj(a[width_ - k]) + (b ? i * std::conj(b[width_ - k]) : Complex());
+
+    rows_fft_.inverse(row.data(), scratch.data());
+
+    for (u32 y = y0; y <= y1 && y < height_; y++)
+    {
+      f32 *state = state_.data() + static_cast<size_t>(y) * width_;
+
+      for (u32 x = 0; x < width_; x++)
+      {
+        f32 avg = (y == y0) ? row[x].real() : row[x].imag();
+        f32 growth = (GaussBell(avg, mu, sigma) * 2.0f) - 1.0f;
+
+        state[x] = std::clamp(state[x] + (1.0f / dt) * growth, 0.0f, 1.0f);
+      }
+    }
+  }
+}
+
+boolean LeniaFFT::setKernel(f32 radius, f32 rho, f32 omega)
+{
+  if (!kernel_.empty() && radius == radius_ && rho == rho_ && omega == omega_)
+    return false;
+
+  radius_ = radius;
+  rho_ = rho;
+  omega_ = omega;
+
+  // Same taps as Convolution() in lenia_cs.glsl, wrapped around the grid
+  std::vector<f32> image(static_cast<size_t>(width_) * height_, 0.0f);
+  s32 r = static_cast<s32>(radius_);
+  s32 w = static_cast<s32>(width_);
+  s32 h = static_cast<s32>(height_);
+  f32 total = 0.0f;
+
+  for (s32 y = -r; y <= r; y++)
+  {
+    for (s32 x = -r; x <= r; x++)
+    {
+      f32 fx = static_cast<f32>(x);
+      f32 fy = static_cast<f32>(y);
+      f32 norm_rad = EuclidianDistance(fx, fy) / radius_;
+      f32 weight = GaussBell(norm_rad, rho_, omega_);
+
+      image[ARRAY_2D_INDEX(((x % w) + w) % w, ((y % h) + h) % h, width_)] += weight;
+      total += weight;
+    }
+  }
+
+  // The weights sum and both inverse FFT scales folded in the spectrum
+  kernel_.assign(spectrum_.size(), Complex());
+  forwardRows(image.data(), kernel_, 0, (height_ + 1) / 2);
+  columns(kernel_, 0, half_, false);
+
+  f32 scale = 1.0f / (total * static_cast<f32>(width_) * static_cast<f32>(height_));
+  for (Complex &value : kernel_)
+    value *= scale;
+
+  return true;
+}
+
+const std::vector<LeniaFFT::Complex> &LeniaFFT::kernel() { return kernel_; }
+
+void LeniaFFT::step(f32 dt, f32 mu, f32 sigma)
+{
+  if (width_ == 0 || height_ == 0 || kernel_.empty())
+    return;
+
+  u32 pairs = (height_ + 1) / 2;
+
+  parallel(pairs, [this](u32 begin, u32 end)
+           { forwardRows(state_.data(), spectrum_, begin, end); });
+
+  parallel(half_, [this](u32 begin, u32 end)
+           { columns(spectrum_, begin, end, true); });
+
+  parallel(pairs, [this, dt, mu, sigma](u32 begin, u32 end)
+           { growthRows(begin, end, dt, mu, sigma); });
+}
+
+void LeniaFFT::load(const u_byte *rgba)
+{
+  for (size_t i = 0; i < state_.size(); i++)
+    state_[i] = static_cast<f32>(rgba[i * 4 + 3]) / 255.0f;
+}
+
+void LeniaFFT::store(u_byte *rgba)
+{
+  u_byte full = 255;
+
+  for (size_t i = 0; i < state_.size(); i++)
+  {
+    rgba[i * 4 + 0] = full;
+    rgba[i * 4 + 1] = full;
+    rgba[i * 4 + 2] = full;
+    rgba[i * 4 + 3] = static_cast<u_byte>(state_[i] * 255.0f + 0.5f);
+  }
+}
@@ -1,11 +1,10 @@
 #include "ia/lenia_op.h"
 #include "ia/gpu_helper.h"
 
-LeniaOp::LeniaOp() {}
-
 float LeniaOp::sumOriginal(Pixel* prev_img, u32 x, u32 y)
 {
   Counter sum = { 0.0f, 0.0f };
+  f32 width = static_cast<f32>(width_), height = static_cast<f32>(height_);
 
   for (s32 ny = -radius_; ny <= radius_; ny++)
   {
@@ -13,16 +12,16 @@ float LeniaOp::sumOriginal(Pixel* prev_img, u32 x, u32 y)
     {
       Math::Vec2 neighbour = Math::Vec2(static_cast<float>(nx), static_cast<float>(ny)) + Math::Vec2(static_cast<float>(x), static_cast<float>(y));
       if (neighbour.y < 0)
-        neighbour.y = (C_HEIGHT + neighbour.y);
-      if (neighbour.y >= C_HEIGHT)
-        neighbour.y -= C_HEIGHT;
+        neighbour.y = (height + neighbour.y);
+      if (neighbour.y >= height)
+        neighbour.y -= height;
 
       if (neighbour.x < 0)
-        neighbour.x = (C_WIDTH + neighbour.x);
-      if (neighbour.x >= C_WIDTH)
-        neighbour.x -= C_WIDTH;
+        neighbour.x = (width + neighbour.x);
+      if (neighbour.x >= width)
+        neighbour.x -= width;
 
-      float alpha = prev_img[ARRAY_2D_INDEX(neighbour.x, neighbour.y, C_WIDTH)].a;
+      float alpha = prev_img[ARRAY_2D_INDEX(neighbour.x, neighbour.y, width_)].a / 255.0f;
 
       float norm_rad = EuclidianDistance(static_cast<float>(nx), static_cast<float>(ny)) / static_cast<float>(radius_);
       float weight = GaussBell(norm_rad, rho_, omega_);
@@ -35,34 +34,37 @@ float LeniaOp::sumOriginal(Pixel* prev_img, u32 x, u32 y)
   return sum.live_ / sum.count_;
 }
 
-float LeniaOp::sumCounter(Counter* counter, u32 x, u32 y)
+float LeniaOp::sumCounter(f32* partial, u32 x, u32 local_y, u32 band_rows)
 {
-  Counter sum = {0.0f, 0.0f};
+  float sum = 0.0f;
 
-  for (u32 i = 0; i < TOTAL_LINES(radius_); i++)
+  for (s32 ny = -radius_; ny <= radius_; ny++)
   {
-    u32 index = ARRAY_3D_INDEX(x, y, i, C_HEIGHT, MAX_RADIUS);
-    sum.live_ += counter[index].live_;
-    sum.count_ += counter[index].count_;
+    u32 row = static_cast<u32>(static_cast<s32>(local_y) + radius_ + ny);
+    sum += partial[(static_cast<u32>(std::abs(ny)) * band_rows + row) * width_ + x];
   }
 
-  return sum.live_ / sum.count_;
+  return sum;
 }
 
-void LeniaOp::checkSingleSlot(Counter *counter, Pixel *prev_img, u32 x, u32 y)
+void LeniaOp::checkSingleSlot(f32 *partial, Pixel *prev_img, u32 x, u32 y, u32 band_start, u32 band_rows)
 {
   float sum_original = sumOriginal(prev_img, x, y);
-  float sum_counter = sumCounter(counter, x, y);
+  float sum_counter = sumCounter(partial, x, y - band_start, band_rows);
 
-  assert(sum_original == sum_counter);
+  // Summed in a different order than the original
+  assert(fabsf(sum_original - sum_counter) < 1e-4f);
 }
 
-void LeniaOp::checkComputeResults()
+void LeniaOp::checkComputeResults(u32 band_start, u32 band_rows)
 {
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
   // Use glGetNamedBufferSubData to retrieve data from the buffer for debugging
-  Counter* data = reinterpret_cast<Counter*>(std::calloc(width_ * height_ * MAX_RADIUS, sizeof(Counter)));
+  size_t count = static_cast<size_t>(radius_ + 1) * band_rows * width_;
+  f32* data = reinterpret_cast<f32*>(std::calloc(count, sizeof(f32)));
   assert(data);
-  glGetNamedBufferSubData(counter_ssbo_, 0, width_ * height_ * MAX_RADIUS * sizeof(Counter), data);
+  glGetNamedBufferSubData(counter_ssbo_, 0, count * sizeof(f32), data);
 
   // Use glGetTexImage to retrieve data from the image for debugging
   Pixel* prev_image_data = reinterpret_cast<Pixel*>(std::calloc(width_ * height_, sizeof(Pixel)));
@@ -70,133 +72,137 @@ void LeniaOp::checkComputeResults()
   glBindTexture(GL_TEXTURE_2D, prev_data_id_);
   glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, prev_image_data);
 
-  for (u32 y = 0; y < C_WIDTH; y++) 
-    for (u32 x = 0; x < C_HEIGHT; x++)
-      checkSingleSlot(data, prev_image_data, x, y);
+  u32 band_end = std::min(band_start + band_rows - TOTAL_LINES(radius_) + 1, height_);
+  for (u32 y = band_start; y < band_end; y++)
+    for (u32 x = 0; x < width_; x++)
+      checkSingleSlot(data, prev_image_data, x, y, band_start, band_rows);
 
   DESTROY(data);
   DESTROY(prev_image_data);
 }
 
-void LeniaOp::init(Math::Vec2 win)
-{
-  loops_ = 0;
-  width_ = static_cast<u32>(win.x);
-  height_ = static_cast<u32>(win.y);
-
-  u_byte *data = reinterpret_cast<u_byte *>(std::calloc(width_ * height_ * 4, sizeof(u_byte)));
-
-  if (!data)
-  {
-    width_ = 0;
-    height_ = 0;
-
-    return;
-  }
-
-  current_data_id_ = GPUHelper::CreateTexture(width_, height_, data);
-  prev_data_id_ = GPUHelper::CreateTexture(width_, height_, data);
-
-  DESTROY(data);
+// Default LeniaOp config
+LeniaOp::LeniaOp()
+    : Automaton("Lenia optimized", Seed::Continuous),
+      radius_(15), dt_(5.0f), mu_(0.14f), sigma_(0.014f), rho_(0.5f), omega_(0.15f),
+      counter_ssbo_(0), counter_radius_(-1), pre_compute_program_(0), compute_program_(0),
+      specialize_(true), specialized_(false) {}
 
-  compileShaders();
+LeniaOp::~LeniaOp() {}
 
-  // Default LeniaOp config
-  radius_ = 15;
-  dt_ = 5.0f;
-  mu_ = 0.14f;
-  sigma_ = 0.014f;
-  rho_ = 0.5f;
-  omega_ = 0.15f;
+void LeniaOp::initResources()
+{
+  glGenBuffers(1, &counter_ssbo_);
+  resizeCounter();
+}
 
-  glUseProgram(compute_program_);
+// Only one band of LENIA_OP_BAND rows plus the halo is kept, with a plane
+// per kernel row 0..radius, so the size follows the active radius
+void LeniaOp::resizeCounter()
+{
+  counter_radius_ = radius_;
+  u32 band_rows = LENIA_OP_BAND + TOTAL_LINES(radius_) - 1;
 
   // Counter
   /////////////////////////////////////////////////////////////////////////////
-  glGenBuffers(1, &counter_ssbo_);
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, counter_ssbo_);
-  glBufferData(GL_SHADER_STORAGE_BUFFER, width_ * height_ * TOTAL_LINES(MAX_RADIUS) * sizeof(Counter), nullptr, GL_DYNAMIC_COPY);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, width_ * band_rows * (radius_ + 1) * sizeof(f32), nullptr, GL_DYNAMIC_COPY);
   glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTER_BIND, counter_ssbo_);
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
   /////////////////////////////////////////////////////////////////////////////
-
-  reset();
 }
 
-LeniaOp::~LeniaOp() {}
-
-void LeniaOp::swap()
+void LeniaOp::releaseResources()
 {
-  std::swap(current_data_id_, prev_data_id_);
+  tables_.release();
+
+  glDeleteBuffers(1, &counter_ssbo_);
+  counter_ssbo_ = 0;
+  counter_radius_ = -1;
 }
 
-void LeniaOp::update()
+size_t LeniaOp::resourceBytes()
 {
-  update_timer_.startTime();
-  loops_++;
-
-  swap();
-  
-  GLenum error = GL_NO_ERROR;
+  size_t band_rows = LENIA_OP_BAND + TOTAL_LINES(counter_radius_) - 1;
+  return tables_.bytes() + width_ * band_rows * static_cast<size_t>(counter_radius_ + 1) * sizeof(f32);
+}
 
-  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTER_BIND, counter_ssbo_);
-  glBindImageTexture(CURR_IMG_BIND, current_data_id_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
-  glBindImageTexture(PREV_IMG_BIND, prev_data_id_, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+void LeniaOp::uploadUniforms(u32 program)
+{
+  glUniform1i(glGetUniformLocation(program, "u_radius"), radius_);
+  glUniform1f(glGetUniformLocation(program, "u_dt"), dt_);
+}
 
-  // GPU Counter
-  /////////////////////////////////////////////////////////////////////////////
-  glUseProgram(pre_compute_program_);
-
-  glUniform1i(glGetUniformLocation(pre_compute_program_, "u_radius"), radius_);
-  glUniform1f(glGetUniformLocation(pre_compute_program_, "u_dt"), dt_);
-  glUniform1f(glGetUniformLocation(pre_compute_program_, "u_mu"), mu_);
-  glUniform1f(glGetUniformLocation(pre_compute_program_, "u_sigma"), sigma_);
-  glUniform1f(glGetUniformLocation(pre_compute_program_, "u_rho"), rho_);
-  glUniform1f(glGetUniformLocation(pre_compute_program_, "u_omega"), omega_);
-
-  glDispatchCompute(width_ / X_THREADS, height_ / Y_THREADS, TOTAL_LINES(radius_));
-  error = glGetError();
-  if (error != GL_NO_ERROR)
-    fprintf(stderr, "Compute Shader Dispatch Error: %d\n", error);
-
-  glMemoryBarrier(GL_ALL_BARRIER_BITS);
-  //checkComputeResults();
-  glUseProgram(0);
-  /////////////////////////////////////////////////////////////////////////////
+void LeniaOp::step()
+{
+  if (radius_ != counter_radius_)
+    resizeCounter();
+
+  tables_.update(static_cast<f32>(radius_), rho_, omega_, mu_, sigma_);
+  tables_.bind();
+
+  // Both passes keep the same partial sums layout, each switches to its
+  // variant as soon as it is ready
+  u32 pre_compute_program = pre_compute_program_;
+  u32 compute_program = compute_program_;
+  specialized_ = false;
+  if (specialize_)
+  {
+    std::string key = tables_.variantKey();
+    auto prefix = [this] { return tables_.variantDefines(); };
 
-  // GPU Automata
-  /////////////////////////////////////////////////////////////////////////////
-  glUseProgram(compute_program_);
+    if (u32 variant = pre_compute_variants_.get(key, prefix))
+      pre_compute_program = variant;
+    if (u32 variant = compute_variants_.get(key, prefix))
+      compute_program = variant;
 
-  glUniform1i(glGetUniformLocation(compute_program_, "u_radius"), radius_);
-  glUniform1f(glGetUniformLocation(compute_program_, "u_dt"), dt_);
-  glUniform1f(glGetUniformLocation(compute_program_, "u_mu"), mu_);
-  glUniform1f(glGetUniformLocation(compute_program_, "u_sigma"), sigma_);
-  glUniform1f(glGetUniformLocation(compute_program_, "u_rho"), rho_);
-  glUniform1f(glGetUniformLocation(compute_program_, "u_omega"), omega_);
+    specialized_ = pre_compute_program != pre_compute_program_ && compute_program != compute_program_;
+  }
 
-  // Dispatch Compute Shader with appropriate workgroup sizes
-  glDispatchCompute(width_ / X_THREADS, height_ / Y_THREADS, 1);
-  error = glGetError();
-  if (error != GL_NO_ERROR)
-    fprintf(stderr, "Compute Shader Dispatch Error: %d\n", error);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTER_BIND, counter_ssbo_);
+  bindImages();
 
-  glMemoryBarrier(GL_ALL_BARRIER_BITS);
+  for (u32 band_start = 0; band_start < height_; band_start += LENIA_OP_BAND)
+  {
+    u32 rows = std::min(static_cast<u32>(LENIA_OP_BAND), height_ - band_start);
+    u32 band_rows = rows + TOTAL_LINES(radius_) - 1;
+
+    // GPU Counter
+    ///////////////////////////////////////////////////////////////////////////
+    glUseProgram(pre_compute_program);
+
+    uploadUniforms(pre_compute_program);
+    glUniform1i(glGetUniformLocation(pre_compute_program, "u_band_start"), static_cast<s32>(band_start));
+    glUniform1i(glGetUniformLocation(pre_compute_program, "u_band_rows"), static_cast<s32>(band_rows));
+
+    gpu_timer_.begin("Counter");
+    dispatch((width_ + X_THREADS - 1) / X_THREADS, (band_rows + Y_THREADS - 1) / Y_THREADS, radius_ + 1);
+    gpu_timer_.end();
+    //checkComputeResults(band_start, band_rows);
+    ///////////////////////////////////////////////////////////////////////////
+
+    // GPU Automata
+    ///////////////////////////////////////////////////////////////////////////
+    glUseProgram(compute_program);
+
+    uploadUniforms(compute_program);
+    glUniform1i(glGetUniformLocation(compute_program, "u_band_start"), static_cast<s32>(band_start));
+    glUniform1i(glGetUniformLocation(compute_program, "u_band_rows"), static_cast<s32>(band_rows));
+
+    // Dispatch Compute Shader with appropriate workgroup sizes
+    gpu_timer_.begin("Update");
+    dispatchCells(width_, rows);
+    gpu_timer_.end();
+    ///////////////////////////////////////////////////////////////////////////
+  }
 
   glUseProgram(0);
-  /////////////////////////////////////////////////////////////////////////////
-
-  glFinish();
-  update_timer_.stopTime();
 }
 
-void LeniaOp::imgui()
+void LeniaOp::imguiParams()
 {
-  ImGui::Begin("GPU Automata");
-
-  ImGui::Text("Type - Lenia optimized");
-  ImGui::Text("Update time: %ld ms", update_timer_.getElapsedTime(TimeCont::Precision::milliseconds));
-  ImGui::Text("Generation: %d", loops_);
+  ImGui::Checkbox("Specialized shaders", &specialize_);
+  ImGui::Text("Kernel: %s", specialized_ ? "specialized" : "generic");
 
   ImGui::SliderInt("Radius", &radius_, 10, MAX_RADIUS);
   ImGui::SliderFloat("Delta Time", &dt_, 5.0f, 15.0f);
@@ -204,76 +210,34 @@ void LeniaOp::imgui()
   ImGui::SliderFloat("Sigma", &sigma_, 0.014f, 0.07f);
   ImGui::SliderFloat("Rho", &rho_, 0.025f, 0.075f);
   ImGui::SliderFloat("Omega", &omega_, 0.05f, 0.025f);
-
-  ImGui::End();
 }
 
-void LeniaOp::reset()
-{
-  loops_ = 0;
-  u_byte *data = reinterpret_cast<u_byte *>(std::calloc(width_ * height_ * 4, sizeof(u_byte)));
-
-  if (!data)
-    return;
-
-  u_byte alive = 255;
-
-  for (u32 i = 0; i < width_ * height_ * 4; i += 4)
-  {
-    data[i + 0] = alive;
-    data[i + 1] = alive;
-    data[i + 2] = alive;
-
-    data[i + 3] = static_cast<u_byte>(rand() % 255);
-  }
-
-  glBindTexture(GL_TEXTURE_2D, current_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
-  glBindTexture(GL_TEXTURE_2D, prev_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
-  glBindTexture(GL_TEXTURE_2D, 0);
-
-  DESTROY(data);
-}
+void LeniaOp::saveParams(std::vector<f32> &params) { params = {static_cast<f32>(radius_), dt_, mu_, sigma_, rho_, omega_}; }
 
-void LeniaOp::clean()
+void LeniaOp::loadParams(const std::vector<f32> &params)
 {
-  u_byte *data = reinterpret_cast<u_byte *>(std::calloc(width_ * height_ * 4, sizeof(u_byte)));
+  if (params.size() > 0)
+    radius_ = std::clamp(static_cast<s32>(params[0]), 1, MAX_RADIUS);
 
-  if (!data)
-    return;
-
-  glBindTexture(GL_TEXTURE_2D, current_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
-  glBindTexture(GL_TEXTURE_2D, prev_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
-  glBindTexture(GL_TEXTURE_2D, 0);
-
-  DESTROY(data);
+  f32 *values[] = {&dt_, &mu_, &sigma_, &rho_, &omega_};
+  for (size_t i = 1; i < std::min(params.size(), std::size(values) + 1); i++)
+    *values[i - 1] = params[i];
 }
 
-u32 LeniaOp::currentTexture() { return current_data_id_; }
-
 void LeniaOp::compileShaders()
 {
   // Pre compute shader
   ///////////////////////////////////////////////////////////////////////////
-  std::string pre_lenia_string = defines + LoadSourceFromFile(SHADER("ia/lenia op/counter_cs.glsl"));
-  const char *pre_lenia_cs = pre_lenia_string.c_str();
-
-  GLuint pre_compute_shader = GPUHelper::CompileShader(GL_COMPUTE_SHADER, pre_lenia_cs, "lenia counter shader");
-  pre_compute_program_ = GPUHelper::CreateProgram(pre_compute_shader, "lenia counter program");
+  std::string tables = LoadSourceFromFile(SHADER("ia/lenia/lenia_tables.glsl"));
+  std::string pre_lenia_source = tables + LoadSourceFromFile(SHADER("ia/lenia op/counter_cs.glsl"));
+  buildProgram(pre_compute_program_, defines + pre_lenia_source, "lenia counter program");
+  pre_compute_variants_.init(pre_lenia_source, "lenia counter program");
   ///////////////////////////////////////////////////////////////////////////
 
   // Compute shader
   /////////////////////////////////////////////////////////////////////////////
-  std::string lenia_string = defines + LoadSourceFromFile(SHADER("ia/lenia op/lenia_op_cs.glsl"));
-  const char *lenia_cs = lenia_string.c_str();
-  GLuint compute_shader = GPUHelper::CompileShader(GL_COMPUTE_SHADER, lenia_cs, "lenia op shader");
-  compute_program_ = GPUHelper::CreateProgram(compute_shader, "lenia op program");
+  std::string lenia_source = tables + LoadSourceFromFile(SHADER("ia/lenia op/lenia_op_cs.glsl"));
+  buildProgram(compute_program_, defines + lenia_source, "lenia op program");
+  compute_variants_.init(lenia_source, "lenia op program");
   /////////////////////////////////////////////////////////////////////////////
 }
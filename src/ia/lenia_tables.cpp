@@ -0,0 +1,125 @@
+#include "ia/lenia_tables.h"
+#include "ia/defines.h"
+
+LeniaTables::LeniaTables()
+    : weights_ssbo_(0), growth_ssbo_(0),
+      radius_(0.0f), rho_(0.0f), omega_(0.0f), mu_(0.0f), sigma_(0.0f) {}
+
+LeniaTables::~LeniaTables() {}
+
+void LeniaTables::update(f32 radius, f32 rho, f32 omega, f32 mu, f32 sigma)
+{
+  if (!weights_ssbo_)
+  {
+    glGenBuffers(1, &weights_ssbo_);
+    glGenBuffers(1, &growth_ssbo_);
+  }
+
+  // Kernel weights
+  /////////////////////////////////////////////////////////////////////////////
+  if (weights_.empty() || radius != radius_ || rho != rho_ || omega != omega_)
+  {
+    radius_ = radius;
+    rho_ = rho;
+    omega_ = omega;
+
+    s32 r = static_cast<s32>(radius_);
+    u32 side = TOTAL_COLUMNS(r);
+    weights_.resize(side * side);
+
+    f32 total = 0.0f;
+    for (s32 y = -r; y <= r; y++)
+    {
+      for (s32 x = -r; x <= r; x++)
+      {
+        f32 fx = static_cast<f32>(x);
+        f32 fy = static_cast<f32>(y);
+        f32 norm_rad = EuclidianDistance(fx, fy) / radius_;
+        f32 weight = GaussBell(norm_rad, rho_, omega_);
+
+        weights_[ARRAY_2D_INDEX(x + r, y + r, side)] = weight;
+        total += weight;
+      }
+    }
+
+    for (f32 &weight : weights_)
+      weight /= total;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, weights_ssbo_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(weights_.size() * sizeof(f32)), weights_.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  }
+  /////////////////////////////////////////////////////////////////////////////
+
+  // Growth, sampled on [0, 1] and linearly interpolated by Growth()
+  /////////////////////////////////////////////////////////////////////////////
+  if (growth_.empty() || mu != mu_ || sigma != sigma_)
+  {
+    mu_ = mu;
+    sigma_ = sigma;
+
+    growth_.resize(GROWTH_LUT_SIZE);
+    for (u32 i = 0; i < GROWTH_LUT_SIZE; i++)
+    {
+      f32 avg = static_cast<f32>(i) / static_cast<f32>(GROWTH_LUT_SIZE - 1);
+      growth_[i] = (GaussBell(avg, mu_, sigma_) * 2.0f) - 1.0f;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, growth_ssbo_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(growth_.size() * sizeof(f32)), growth_.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  }
+  /////////////////////////////////////////////////////////////////////////////
+}
+
+std::string LeniaTables::variantKey()
+{
+  // Exact floats, sliders land on many nearby values
+  char key[96];
+  snprintf(key, sizeof(key), "%a %a %a", static_cast<f64>(radius_), static_cast<f64>(rho_), static_cast<f64>(omega_));
+  return key;
+}
+
+std::string LeniaTables::variantDefines()
+{
+  s32 r = static_cast<s32>(radius_);
+
+  std::string prefix = "#define RADIUS " + std::to_string(r) + "\n";
+  prefix += "const float WEIGHTS[" + std::to_string(weights_.size()) + "] = float[](";
+
+  for (size_t i = 0; i < weights_.size(); i++)
+  {
+    char weight[32];
+    snprintf(weight, sizeof(weight), "%.9e", static_cast<f64>(weights_[i]));
+    prefix += (i > 0) ? "," : "";
+    prefix += weight;
+  }
+  prefix += ");\n";
+
+  return prefix;
+}
+
+void LeniaTables::release()
+{
+  if (!weights_ssbo_)
+    return;
+
+  glDeleteBuffers(1, &weights_ssbo_);
+  glDeleteBuffers(1, &growth_ssbo_);
+  weights_ssbo_ = 0;
+  growth_ssbo_ = 0;
+
+  weights_.clear();
+  growth_.clear();
+}
+
+size_t LeniaTables::bytes()
+{
+  return weights_ssbo_ ? (weights_.size() + growth_.size()) * sizeof(f32) : 0;
+}
+
+void LeniaTables::bind()
+{
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, WEIGHTS_BIND, weights_ssbo_);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GROWTH_BIND, growth_ssbo_);
+}
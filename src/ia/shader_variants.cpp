@@ -0,0 +1,79 @@
+#include "ia/shader_variants.h"
+#include "ia/gpu_helper.h"
+#include "ia/defines.h"
+
+ShaderVariants::ShaderVariants() : name_(""), settled_(0) {}
+
+ShaderVariants::~ShaderVariants() {}
+
+void ShaderVariants::init(const std::string &source, const char *name)
+{
+  release();
+
+  source_ = source;
+  name_ = name;
+}
+
+u32 ShaderVariants::get(const std::string &key, const std::function<std::string()> &prefix)
+{
+  auto found = variants_.find(key);
+
+  // Settle
+  /////////////////////////////////////////////////////////////////////////////
+  if (found == variants_.end())
+  {
+    if (key != last_key_)
+    {
+      last_key_ = key;
+      settled_ = 0;
+    }
+
+    if (++settled_ < VARIANT_SETTLE_UPDATES)
+      return 0;
+
+    if (order_.size() >= MAX_SHADER_VARIANTS)
+    {
+      Variant &oldest = variants_[order_.front()];
+      if (oldest.program)
+        glDeleteProgram(oldest.program);
+
+      variants_.erase(order_.front());
+      order_.erase(order_.begin());
+    }
+
+    found = variants_.emplace(key, Variant{0, std::string(), false}).first;
+    order_.push_back(key);
+
+    Variant &variant = found->second;
+    variant.program = GPUHelper::StartComputeProgram(defines + prefix() + source_, variant.cache_path);
+  }
+  /////////////////////////////////////////////////////////////////////////////
+
+  Variant &variant = found->second;
+  if (!variant.ready)
+  {
+    if (!GPUHelper::ComputeProgramDone(variant.program))
+      return 0;
+
+    // A variant that fails stays in the cache as 0, the generic program
+    // keeps running instead of retrying every update
+    variant.program = GPUHelper::FinishComputeProgram(variant.program, variant.cache_path, name_);
+    variant.ready = true;
+  }
+
+  return variant.program;
+}
+
+void ShaderVariants::release()
+{
+  for (auto &entry : variants_)
+  {
+    if (entry.second.program)
+      glDeleteProgram(entry.second.program);
+  }
+
+  variants_.clear();
+  order_.clear();
+  last_key_.clear();
+  settled_ = 0;
+}
@@ -2,156 +2,130 @@
 #include "ia/gpu_helper.h"
 #include "ia/defines.h"
 
+// Checks the summed-area table against the previous image
 void CheckComputeResults(GLuint counter_ssbo, GLuint prev_data_id, u32 width, u32 height)
 {
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
   // Use glGetNamedBufferSubData to retrieve data from the buffer for debugging
-  Counter *data = reinterpret_cast<Counter *>(std::calloc(width * height, sizeof(Counter)));
-  glGetNamedBufferSubData(counter_ssbo, 0, width * height * sizeof(Counter), data);
+  u32 *data = reinterpret_cast<u32 *>(std::calloc(width * height, sizeof(u32)));
+  glGetNamedBufferSubData(counter_ssbo, 0, width * height * sizeof(u32), data);
 
   // Use glGetTexImage to retrieve data from the image for debugging
   u_byte *prev_image_data = reinterpret_cast<u_byte *>(std::calloc(width * height * 4, sizeof(u_byte)));
   glBindTexture(GL_TEXTURE_2D, prev_data_id);
   glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, prev_image_data);
 
-  DESTROY(data);
-  DESTROY(prev_image_data);
-}
-
-SmoothLife::SmoothLife() {}
-
-void SmoothLife::init(Math::Vec2 win)
-{
-  loops_ = 0;
-  width_ = static_cast<u32>(win.x);
-  height_ = static_cast<u32>(win.y);
-  outter_rad_ = O_RADIUS;
-  inner_rad_ = I_RADIUS;
-  depth_ = C_DEPTH;
-
-  u_byte *data = reinterpret_cast<u_byte *>(std::calloc(width_ * height_ * 4, sizeof(u_byte)));
-
-  if (!data)
+  std::vector<u32> column(width, 0);
+  for (u32 y = 0; y < height; y++)
   {
-    width_ = 0;
-    height_ = 0;
-
-    return;
+    u32 row = 0;
+    for (u32 x = 0; x < width; x++)
+    {
+      row += prev_image_data[(ARRAY_2D_INDEX(x, y, width)) * 4 + 3] > 127 ? 1 : 0;
+      column[x] += row;
+      assert(data[ARRAY_2D_INDEX(x, y, width)] == column[x]);
+    }
   }
 
-  current_data_id_ = GPUHelper::CreateTexture(width_, height_, data);
-  prev_data_id_ = GPUHelper::CreateTexture(width_, height_, data);
-
   DESTROY(data);
+  DESTROY(prev_image_data);
+}
 
-  compileShaders();
+SmoothLife::SmoothLife()
+    : Automaton("Smooth life", Seed::Binary),
+      pre_compute_program_(0), compute_program_(0),
+      outter_rad_(O_RADIUS), inner_rad_(I_RADIUS),
+      counter_ssbo_(0), spans_ssbo_(0), span_count_(0) {}
 
+SmoothLife::~SmoothLife() {}
+
+void SmoothLife::initResources()
+{
   glUseProgram(compute_program_);
 
-  // Counter
+  // Summed-area table
   /////////////////////////////////////////////////////////////////////////////
+  GLsizeiptr size = static_cast<GLsizeiptr>(width_) * height_ * sizeof(u32);
+
+  GLint64 max_block = 0;
+  glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &max_block);
+  if (size > max_block)
+    fprintf(stderr, "Smooth life table of %lld bytes over the %lld bytes storage block limit\n",
+            static_cast<long long>(size), static_cast<long long>(max_block));
+
   glGenBuffers(1, &counter_ssbo_);
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, counter_ssbo_);
-  glBufferData(GL_SHADER_STORAGE_BUFFER, width_ * height_ * sizeof(Counter), nullptr, GL_DYNAMIC_COPY);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
   glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTER_BIND, counter_ssbo_);
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
   /////////////////////////////////////////////////////////////////////////////
 
-  // Counter indices
+  // Spans
   /////////////////////////////////////////////////////////////////////////////
-  Math::Vec2 *indices = reinterpret_cast<Math::Vec2 *>(std::calloc(width_ * height_ * depth_, sizeof(Math::Vec2)));
-
-  Math::Vec2 coords[static_cast<u32>(NEAR_NEIGHBORS)] = {
-      Math::Vec2(-1.0f, -1.0f), Math::Vec2(+1.0f, -1.0f),
-      Math::Vec2(-1.0f, +0.0f), Math::Vec2(+1.0f, +0.0f),
-      Math::Vec2(-1.0f, +1.0f), Math::Vec2(+1.0f, +1.0f)};
-
-  for (s32 col = 0; col < static_cast<s32>(width_); col++)
+  // Offsets from the cell, the same for every pixel: rows [x, y] and
+  // columns (z, w]. Near neighbours first, then the outer disk with the rows
+  // of equal half width merged, so inside the grid each entry is a single
+  // rectangle of the summed-area table.
+  std::vector<s32> spans = {-1, 1, -1, 1};
+
+  f32 y = -outter_rad_;
+  for (s32 row = 0; row < static_cast<s32>(outter_rad_ * 2.0f); row++, y++)
   {
-    for (s32 row = 0; row < static_cast<s32>(height_); row++)
-    {
-      f32 y = -O_RADIUS;
-      for (s32 depth = 0; depth < static_cast<s32>(depth_); depth += 2)
-      {
-        u32 index = ARRAY_3D_INDEX(col, row, depth, height_, depth_);
-
-        Math::Vec2 start_coord;
-        Math::Vec2 end_coord;
-
-        if (depth < static_cast<s32>(NEAR_NEIGHBORS))
-        {
-          start_coord = coords[depth] + Math::Vec2(static_cast<f32>(col), static_cast<f32>(row));
-          end_coord = coords[depth + 1] + Math::Vec2(static_cast<f32>(col), static_cast<f32>(row));
-        }
-        else
-        {
-          f32 x_offset = std::floor(sqrtf((outter_rad_ * outter_rad_) - (y * y)));
-          start_coord = Math::Vec2(static_cast<f32>(col) - x_offset - 1.0f, static_cast<f32>(row) + y);
-          end_coord = Math::Vec2(static_cast<f32>(col) + x_offset, static_cast<f32>(row) + y);
-          y++;
-        }
-
-        start_coord.x = std::max(start_coord.x, 0.0f);
-        start_coord.x = std::min(start_coord.x, static_cast<f32>(width_) - 1.0f);
-
-        start_coord.y = std::max(start_coord.y, 0.0f);
-        start_coord.y = std::min(start_coord.y, static_cast<f32>(height_) - 1.0f);
-
-        end_coord.x = std::max(end_coord.x, 0.0f);
-        end_coord.x = std::min(end_coord.x, static_cast<f32>(width_) - 1.0f);
+    s32 x_offset = static_cast<s32>(std::floor(sqrtf((outter_rad_ * outter_rad_) - (y * y))));
+    s32 dy = static_cast<s32>(y);
 
-        end_coord.y = std::max(end_coord.y, 0.0f);
-        end_coord.y = std::min(end_coord.y, static_cast<f32>(height_) - 1.0f);
-
-        indices[index] = start_coord;
-        indices[index + 1] = end_coord;
-      }
+    size_t last = spans.size() - 4;
+    if (row > 0 && spans[last + 3] == x_offset && spans[last + 1] == dy - 1)
+    {
+      spans[last + 1] = dy;
+      continue;
     }
+
+    spans.insert(spans.end(), {dy, dy, -x_offset - 1, x_offset});
   }
 
-  glGenBuffers(1, &counter_indices_ssbo_);
-  glBindBuffer(GL_SHADER_STORAGE_BUFFER, counter_indices_ssbo_);
-  glBufferData(GL_SHADER_STORAGE_BUFFER, width_ * height_ * depth_ * sizeof(Math::Vec2), indices, GL_STATIC_COPY);
-  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDICES_BIND, counter_indices_ssbo_);
+  span_count_ = static_cast<u32>(spans.size() / 4);
+
+  glGenBuffers(1, &spans_ssbo_);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, spans_ssbo_);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, spans.size() * sizeof(s32), spans.data(), GL_STATIC_DRAW);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDICES_BIND, spans_ssbo_);
 
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
   glUseProgram(0);
-
-  DESTROY(indices);
   /////////////////////////////////////////////////////////////////////////////
-
-  reset();
 }
 
-SmoothLife::~SmoothLife() {}
-
-void SmoothLife::swap()
+void SmoothLife::releaseResources()
 {
-  std::swap(current_data_id_, prev_data_id_);
+  glDeleteBuffers(1, &counter_ssbo_);
+  glDeleteBuffers(1, &spans_ssbo_);
+  counter_ssbo_ = 0;
+  spans_ssbo_ = 0;
 }
 
-void SmoothLife::update()
+size_t SmoothLife::resourceBytes()
 {
-  update_timer_.startTime();
-  loops_++;
-
-  swap();
-  GLenum error = GL_NO_ERROR;
+  return static_cast<size_t>(width_) * height_ * sizeof(u32) + span_count_ * 4 * sizeof(s32);
+}
 
-  // GPU Counter
+void SmoothLife::step()
+{
+  // GPU Summed-area table
   /////////////////////////////////////////////////////////////////////////////
   glUseProgram(pre_compute_program_);
 
   glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTER_BIND, counter_ssbo_);
-  glBindImageTexture(CURR_IMG_BIND, current_data_id_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
-  glBindImageTexture(PREV_IMG_BIND, prev_data_id_, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
-
-  // Dispatch Compute Shader with appropriate workgroup sizes
-  glDispatchCompute(1, height_, 1);
-  error = glGetError();
-  if (error != GL_NO_ERROR)
-    fprintf(stderr, "Compute Shader Dispatch Error: %d\n", error);
-
-  glMemoryBarrier(GL_ALL_BARRIER_BITS);
+  bindImages();
+
+  // Row scans then column scans, one workgroup per line
+  gpu_timer_.begin("Summed-area table");
+  glUniform1i(glGetUniformLocation(pre_compute_program_, "u_vertical"), 0);
+  dispatch(height_, 1);
+  glUniform1i(glGetUniformLocation(pre_compute_program_, "u_vertical"), 1);
+  dispatch(width_, 1);
+  gpu_timer_.end();
   // CheckComputeResults(counter_ssbo_, prev_data_id_, width_, height_);
   glUseProgram(0);
   /////////////////////////////////////////////////////////////////////////////
@@ -161,106 +135,37 @@ void SmoothLife::update()
   glUseProgram(compute_program_);
 
   glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTER_BIND, counter_ssbo_);
-  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDICES_BIND, counter_indices_ssbo_);
-  glBindImageTexture(CURR_IMG_BIND, current_data_id_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
-  glBindImageTexture(PREV_IMG_BIND, prev_data_id_, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDICES_BIND, spans_ssbo_);
+  bindImages();
 
-  // Dispatch Compute Shader with appropriate workgroup sizes
-  glDispatchCompute(width_ / X_THREADS, height_ / Y_THREADS, 1);
-  error = glGetError();
-  if (error != GL_NO_ERROR)
-    fprintf(stderr, "Compute Shader Dispatch Error: %d\n", error);
+  glUniform1i(glGetUniformLocation(compute_program_, "u_spans"), static_cast<s32>(span_count_));
+  glUniform1i(glGetUniformLocation(compute_program_, "u_reach"), static_cast<s32>(outter_rad_) + 1);
 
-  glMemoryBarrier(GL_ALL_BARRIER_BITS);
+  // Dispatch Compute Shader with appropriate workgroup sizes
+  gpu_timer_.begin("Update");
+  dispatchCells(width_, height_);
+  gpu_timer_.end();
 
   glUseProgram(0);
   /////////////////////////////////////////////////////////////////////////////
-
-  glFinish();
-  update_timer_.stopTime();
 }
 
-void SmoothLife::imgui()
+void SmoothLife::imguiParams()
 {
-  ImGui::Begin("GPU Automata");
-
-  ImGui::Text("Type - Smooth life");
-  ImGui::Text("Update time: %ld mcs", update_timer_.getElapsedTime(TimeCont::Precision::microseconds));
-  ImGui::Text("Generation: %d", loops_);
-
   ImGui::Text("Radius: %.1f", O_RADIUS);
-
-  ImGui::End();
 }
 
-void SmoothLife::reset()
-{
-  loops_ = 0;
-  u_byte *data = reinterpret_cast<u_byte *>(std::calloc(width_ * height_ * 4, sizeof(u_byte)));
-
-  if (!data)
-    return;
-
-  u_byte alive = 255;
-  u_byte dead = 0;
-
-  for (u32 i = 0; i < width_ * height_ * 4; i += 4)
-  {
-    data[i + 0] = alive;
-    data[i + 1] = alive;
-    data[i + 2] = alive;
-
-    data[i + 3] = (rand() % 5 < 2) ? alive : dead;
-  }
-
-  glBindTexture(GL_TEXTURE_2D, current_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
-  glBindTexture(GL_TEXTURE_2D, prev_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
-  glBindTexture(GL_TEXTURE_2D, 0);
-
-  DESTROY(data);
-}
-
-void SmoothLife::clean()
-{
-  u_byte *data = reinterpret_cast<u_byte *>(std::calloc(width_ * height_ * 4, sizeof(u_byte)));
-
-  if (!data)
-    return;
-
-  glBindTexture(GL_TEXTURE_2D, current_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
-  glBindTexture(GL_TEXTURE_2D, prev_data_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
-  glBindTexture(GL_TEXTURE_2D, 0);
-
-  DESTROY(data);
-}
-
-u32 SmoothLife::currentTexture() { return current_data_id_; }
-
 void SmoothLife::compileShaders()
 {
   // Pre Compute shader
   /////////////////////////////////////////////////////////////////////////////
-  std::string pre_compute = defines + LoadSourceFromFile(SHADER("ia/smooth/counter_cs.glsl"));
-  const char *pre_compute_cs = pre_compute.c_str();
-
-  GLuint pre_compute_shader = GPUHelper::CompileShader(GL_COMPUTE_SHADER, pre_compute_cs, "pre smooth shader");
-  pre_compute_program_ = GPUHelper::CreateProgram(pre_compute_shader, "pre smooth program");
+  std::string pre_compute = defines + LoadSourceFromFile(SHADER("ia/smooth/sat_cs.glsl"));
+  buildProgram(pre_compute_program_, pre_compute, "pre smooth program");
   /////////////////////////////////////////////////////////////////////////////
 
   // Compute shader
   /////////////////////////////////////////////////////////////////////////////
   std::string smooth_string = defines + LoadSourceFromFile(SHADER("ia/smooth/smooth_cs.glsl"));
-  const char *smooth_cs = smooth_string.c_str();
-
-  GLuint compute_shader = GPUHelper::CompileShader(GL_COMPUTE_SHADER, smooth_cs, "smooth shader");
-  compute_program_ = GPUHelper::CreateProgram(compute_shader, "smoot program");
+  buildProgram(compute_program_, smooth_string, "smoot program");
   /////////////////////////////////////////////////////////////////////////////
 }
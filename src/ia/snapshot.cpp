@@ -0,0 +1,279 @@
+#include "ia/snapshot.h"
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(Snapshot::Header) == 88, "Snapshot header layout changed, bump SNAPSHOT_VERSION");
+
+// PackBits: a control byte c below 128 is followed by c + 1 literal bytes,
+// above 128 by one byte repeated 257 - c times
+static void CompressRLE(const std::vector<u_byte> &cells, std::vector<u_byte> &data)
+{
+  data.clear();
+  data.reserve(cells.size() / 4);
+
+  size_t count = cells.size();
+  for (size_t i = 0; i < count;)
+  {
+    size_t run = 1;
+    while (i + run < count && run < 128 && cells[i + run] == cells[i])
+      run++;
+
+    if (run >= 2)
+    {
+      data.push_back(static_cast<u_byte>(257 - run));
+      data.push_back(cells[i]);
+      i += run;
+      continue;
+    }
+
+    // Literals until the next run of 3
+    size_t start = i;
+    while (i < count && i - start < 128 && !(i + 2 < count && cells[i] == cells[i + 1] && cells[i] == cells[i + 2]))
+      i++;
+
+    data.push_back(static_cast<u_byte>(i - start - 1));
+    data.insert(data.end(), cells.begin() + static_cast<std::ptrdiff_t>(start), cells.begin() + static_cast<std::ptrdiff_t>(i));
+  }
+}
+
+void Snapshot::Encode(const u_byte *rgba, size_t cells, u32 encoding, u32 compression, std::vector<u_byte> &data)
+{
+  std::vector<u_byte> packed;
+  Pack(rgba, cells, encoding, packed);
+  Compress(packed, compression, data);
+}
+
+void Snapshot::Pack(const u_byte *rgba, size_t cells, u32 encoding, std::vector<u_byte> &packed)
+{
+  if (encoding == SNAPSHOT_BITS)
+  {
+    packed.assign((cells + 7) / 8, 0);
+    for (size_t i = 0; i < cells; i++)
+      packed[i >> 3] |= static_cast<u_byte>((rgba[i * 4 + 3] > 127) << (i & 7));
+  }
+  else
+  {
+    packed.resize(cells);
+    for (size_t i = 0; i < cells; i++)
+      packed[i] = rgba[i * 4 + 3];
+  }
+}
+
+void Snapshot::Compress(std::vector<u_byte> &packed, u32 compression, std::vector<u_byte> &data)
+{
+  if (compression == SNAPSHOT_RAW)
+  {
+    data.swap(packed);
+    return;
+  }
+
+  // Smooth fields turn into long runs of small differences
+  if (compression == SNAPSHOT_DELTA_RLE)
+  {
+    for (size_t i = packed.size(); i-- > 1;)
+      packed[i] = static_cast<u_byte>(packed[i] - packed[i - 1]);
+  }
+
+  CompressRLE(packed, data);
+}
+
+boolean Snapshot::Decompress(const u_byte *data, size_t size, u32 compression, size_t cells_size, std::vector<u_byte> &cells)
+{
+  cells.resize(cells_size);
+
+  size_t out = 0;
+  for (size_t in = 0; in < size;)
+  {
+    u_byte control = data[in++];
+    if (control < 128)
+    {
+      size_t count = static_cast<size_t>(control) + 1;
+      if (in + count > size || out + count > cells_size)
+        return false;
+
+      std::memcpy(cells.data() + out, data + in, count);
+      in += count;
+      out += count;
+    }
+    else if (control > 128)
+    {
+      size_t count = 257 - static_cast<size_t>(control);
+      if (in >= size || out + count > cells_size)
+        return false;
+
+      std::memset(cells.data() + out, data[in++], count);
+      out += count;
+    }
+    else
+      return false;
+  }
+
+  if (out != cells_size)
+    return false;
+
+  if (compression == SNAPSHOT_DELTA_RLE)
+  {
+    for (size_t i = 1; i < cells_size; i++)
+      cells[i] = static_cast<u_byte>(cells[i] + cells[i - 1]);
+  }
+
+  return true;
+}
+
+boolean Snapshot::Write(const std::string &path, const Header &header, const std::vector<f32> &params, const std::vector<u_byte> &data)
+{
+  std::error_code error;
+  std::filesystem::path parent = std::filesystem::path(path).parent_path();
+  if (!parent.empty())
+    std::filesystem::create_directories(parent, error);
+
+  std::string temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(params.data()), static_cast<std::streamsize>(params.size() * sizeof(f32)));
+    file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+
+    if (!file)
+    {
+      fprintf(stderr, "Can not write the snapshot %s\n", temporary.c_str());
+      return false;
+    }
+  }
+
+  std::filesystem::rename(temporary, path, error);
+  if (error)
+  {
+    fprintf(stderr, "Can not write the snapshot %s: %s\n", path.c_str(), error.message().c_str());
+    return false;
+  }
+
+  return true;
+}
+
+boolean Snapshot::Parse(const u_byte *file, size_t size, Header &header, const u_byte *&params, const u_byte *&data)
+{
+  if (size < sizeof(Header))
+    return false;
+
+  std::memcpy(&header, file, sizeof(Header));
+  if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) || header.version != SNAPSHOT_VERSION)
+    return false;
+
+  if (header.encoding > SNAPSHOT_BYTES || header.compression > SNAPSHOT_DELTA_RLE)
+    return false;
+
+  u64 cells = static_cast<u64>(header.width) * header.height;
+  u64 cells_size = (header.encoding == SNAPSHOT_BITS) ? (cells + 7) / 8 : cells;
+  if (header.cells_size != cells_size || (header.compression == SNAPSHOT_RAW && header.data_size != cells_size))
+    return false;
+
+  u64 params_size = static_cast<u64>(header.params) * sizeof(f32);
+  u64 available = size - sizeof(Header);
+  if (params_size > available || header.data_size > available - params_size)
+    return false;
+
+  params = file + sizeof(Header);
+  data = params + params_size;
+  return true;
+}
+
+MappedFile::MappedFile()
+    : data_(nullptr), size_(0)
+#ifdef _WIN32
+      ,
+      file_(nullptr), mapping_(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile() { close(); }
+
+boolean MappedFile::open(const std::string &path)
+{
+  close();
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  HANDLE mapping = nullptr;
+  if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+  if (!mapping)
+  {
+    CloseHandle(file);
+    return false;
+  }
+
+  file_ = file;
+  mapping_ = mapping;
+  data_ = static_cast<const u_byte *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  size_ = static_cast<size_t>(size.QuadPart);
+#else
+  s32 file = ::open(path.c_str(), O_RDONLY);
+  if (file < 0)
+    return false;
+
+  struct stat info;
+  void *mapped = MAP_FAILED;
+  if (fstat(file, &info) == 0 && info.st_size > 0)
+    mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+  // The mapping keeps its own reference to the file
+  ::close(file);
+  if (mapped == MAP_FAILED)
+    return false;
+
+  // Read once from start to end
+  madvise(mapped, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+  data_ = static_cast<const u_byte *>(mapped);
+  size_ = static_cast<size_t>(info.st_size);
+#endif
+
+  if (!data_)
+  {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+  if (data_)
+    UnmapViewOfFile(data_);
+  if (mapping_)
+    CloseHandle(mapping_);
+  if (file_)
+    CloseHandle(file_);
+  file_ = nullptr;
+  mapping_ = nullptr;
+#else
+  if (data_)
+    munmap(const_cast<u_byte *>(data_), size_);
+#endif
+
+  data_ = nullptr;
+  size_ = 0;
+}
+
+const u_byte *MappedFile::data() { return data_; }
+
+size_t MappedFile::size() { return size_; }
@@ -4,6 +4,10 @@
 static f32 win_x = C_WIDTH * SCALAR_SIZE;
 static f32 win_y = C_HEIGHT * SCALAR_SIZE;
 
+// Grid size, -s WIDTHxHEIGHT or the ImGui panel, the window keeps its size
+static u32 grid_width = C_WIDTH;
+static u32 grid_height = C_HEIGHT;
+
 static const Camera::CamConfig config = {
     .camera_render_type_ = Camera::RenderType::Orthographic,
     .light_render_type_ = Camera::LightRenderType::Forward,
@@ -26,24 +30,13 @@ static Camera camera;
 static Mesh *quad = nullptr;
 static Material *img = nullptr;
 
-const static s32 max_modes = 3;
-static s32 mode = 0;
-static Conway conway;
-static SmoothLife smooth_life;
-static Lenia lenia;
-static LeniaOp lenia_op;
-
-void ChangeMode(s32 &mode, s32 signess, s32 min, s32 max)
-{
-  mode += signess;
+static AutomataRegistry automata;
 
-  if (mode > max)
-    mode = min;
-  if (mode < min)
-    mode = max;
-
-  fprintf(stdout, "Mode: %d\n", mode);
-}
+// F9 records the shown generations to EXPORT_DIR, frames the encoders can
+// not keep up with are dropped
+static FrameCapture capture;
+static FrameExporter exporter;
+static u64 captured_generation = 0;
 
 void UserInit(s32 argc, byte *argv[], void *)
 {
@@ -57,10 +50,11 @@ void UserInit(s32 argc, byte *argv[], void *)
   quad = JAM_Engine::GetMesh(Mesh::Platonic::k_Quad);
 
   // GPU Automata
-  conway.init(Math::Vec2(C_WIDTH, C_HEIGHT));
-  smooth_life.init(Math::Vec2(C_WIDTH, C_HEIGHT));
-  lenia.init(Math::Vec2(C_WIDTH, C_HEIGHT));
-  lenia_op.init(Math::Vec2(C_WIDTH, C_HEIGHT));
+  automata.add<Conway>();
+  automata.add<SmoothLife>();
+  automata.add<Lenia>();
+  automata.add<LeniaOp>();
+  automata.init(Math::Vec2(static_cast<f32>(grid_width), static_cast<f32>(grid_height)));
 
   Transform tr;
   tr.scale(Math::Vec3(1.0f));
@@ -77,37 +71,43 @@ void UserUpdate(void *)
 {
   frames++;
 
-  u32 texture_id;
-  if (mode == 0)
-  {
-    conway.update();
-    conway.imgui();
-    texture_id = conway.currentTexture();
-  }
-
-  if (mode == 1)
-  {
-    smooth_life.update();
-    smooth_life.imgui();
-    texture_id = smooth_life.currentTexture();
-  }
+  automata.update();
+  automata.imgui();
+  u32 texture_id = automata.active()->currentTexture();
 
-  if (mode == 2)
+  if (JAM_Engine::InputDown(Inputs::Key::Key_F9))
   {
-    lenia.update();
-    lenia.imgui();
-    texture_id = lenia.currentTexture();
+    if (exporter.running())
+    {
+      exporter.stop();
+      capture.release();
+      fprintf(stdout, "Recorded %llu frames, dropped %llu\n", static_cast<unsigned long long>(exporter.written()), static_cast<unsigned long long>(capture.dropped()));
+    }
+    else
+      exporter.start(&capture, EXPORT_DIR, FrameExporter::Format::PNG);
   }
 
-  if (mode == 3)
+  if (exporter.running())
   {
-    lenia_op.update();
-    lenia_op.imgui();
-    texture_id = lenia_op.currentTexture();
+    Automaton *active = automata.active();
+    if (active->generation() != captured_generation)
+    {
+      capture.capture(texture_id, active->width(), active->height(), active->generation());
+      captured_generation = active->generation();
+    }
+    else
+      capture.poll();
+
+    exporter.pump();
   }
 
+  // Materials and compute programs, the automata keep stepping with the old
+  // programs while the new ones compile
   if (JAM_Engine::InputDown(Inputs::Key::Key_F5))
+  {
     JAM_Engine::RechargeShaders();
+    automata.reload();
+  }
 
   JAM_Engine::BeginRender(&camera);
 
@@ -118,27 +118,32 @@ void UserUpdate(void *)
   JAM_Engine::EndRender();
 
   if (JAM_Engine::InputDown(Inputs::Key::Key_R))
-  {
-    if (mode == 0)
-      conway.reset();
-    if (mode == 1)
-      smooth_life.reset();
-    if (mode == 2)
-      lenia.reset();
-    if (mode == 3)
-      lenia_op.reset();
-  }
+    automata.reset();
 
   if (JAM_Engine::InputDown(Inputs::Key::Key_Left))
-    ChangeMode(mode, -1, 0, max_modes);
+    automata.prev();
   if (JAM_Engine::InputDown(Inputs::Key::Key_Right))
-    ChangeMode(mode, 1, 0, max_modes);
+    automata.next();
 }
 
-void UserClean(void *) {}
+void UserClean(void *)
+{
+  exporter.stop();
+  capture.release();
+}
 
 s32 main(s32 argc, byte *argv[])
 {
+  for (s32 i = 1; i + 1 < argc; i++)
+  {
+    if (!strcmp(argv[i], "-s") && sscanf(argv[i + 1], "%ux%u", &grid_width, &grid_height) != 2)
+    {
+      fprintf(stderr, "Grid size must be WIDTHxHEIGHT: %s\n", argv[i + 1]);
+      grid_width = C_WIDTH;
+      grid_height = C_HEIGHT;
+    }
+  }
+
   JAM_Engine::Config config = {argc, argv, static_cast<s32>(win_x), static_cast<s32>(win_y), false, false, true};
   JAM_Engine::Init(UserInit, config);
   JAM_Engine::Update(UserUpdate);
@@ -108,6 +108,7 @@ files {
   "../include/**",
   "../src/**",
 }
+removefiles { "../src/headless.cpp" } -- Linux only (EGL), see .vscode/tasks.json
 filter "files:**.obj"
     flags { "ExcludeFromBuild" }
 -------------------------------------------------------------------------------